@@ -0,0 +1,260 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include "SlowAudioSource.h"
+#include "SimdReverb.h"
+#include <atomic>
+#include <iostream>
+
+BatchRenderer::BatchRenderer(const Options& renderOptions) : options(renderOptions)
+{
+    formatManager.registerBasicFormats();
+}
+
+BatchRenderer::~BatchRenderer()
+{
+}
+
+int BatchRenderer::renderAll()
+{
+    const int numFiles = options.files.size();
+    int numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+    numThreads = juce::jmax(1, juce::jmin(numThreads, numFiles));
+
+    // each job only writes its own slot, so the results don't need a lock
+    juce::StringArray errors;
+    errors.ensureStorageAllocated(numFiles);
+    for (int i = 0; i < numFiles; i++) {
+        errors.add({});
+    }
+    std::vector<double> seconds((size_t) numFiles, 0.0);
+
+    // two inputs with the same name in different folders mustn't be rendered to the same file
+    juce::Array<juce::File> outputFiles;
+    juce::StringArray usedNames;
+    for (auto& file : options.files)
+    {
+        juce::String name = file.getFileNameWithoutExtension();
+        for (int suffix = 2; usedNames.contains(name, true); suffix++) {
+            name = file.getFileNameWithoutExtension() + " (" + juce::String(suffix) + ")";
+        }
+        usedNames.add(name);
+        outputFiles.add(options.outputFolder.getChildFile(name + ".wav"));
+    }
+
+    const juce::uint32 startTime = juce::Time::getMillisecondCounter();
+
+    if (numFiles > 0) {
+        juce::ThreadPool pool(numThreads);
+        std::atomic<int> jobsLeft(numFiles);
+        juce::WaitableEvent finished;
+        juce::CriticalSection outputLock;
+
+        for (int i = 0; i < numFiles; i++)
+        {
+            pool.addJob([this, i, numFiles, &outputFiles, &errors, &seconds, &jobsLeft, &finished, &outputLock]
+            {
+                errors.getReference(i) = renderFile(options.files.getReference(i), outputFiles.getReference(i), seconds[(size_t) i]);
+                int numDone = numFiles - --jobsLeft;
+
+                {
+                    const juce::ScopedLock sl(outputLock);
+                    std::cout << "[" << numDone << "/" << numFiles << "] " << options.files.getReference(i).getFileName() << std::endl;
+                }
+
+                if (numDone == numFiles) {
+                    finished.signal();
+                }
+            });
+        }
+
+        finished.wait();
+    }
+
+    double elapsed = juce::jmax(0.001, (juce::Time::getMillisecondCounter() - startTime) / 1000.0);
+    double audioSeconds = 0.0;
+    int numFailed = 0;
+
+    for (int i = 0; i < numFiles; i++)
+    {
+        if (errors[i].isNotEmpty()) {
+            std::cerr << "Couldn't render " << options.files.getReference(i).getFullPathName() << ": " << errors[i] << std::endl;
+            numFailed++;
+        }
+        audioSeconds += seconds[(size_t) i];
+    }
+
+    std::cout << (numFiles - numFailed) << " of " << numFiles << " files rendered in " << elapsed << " s on "
+              << numThreads << " threads" << std::endl
+              << (numFiles - numFailed) / elapsed << " files/sec, realtime factor " << audioSeconds / elapsed << "x" << std::endl;
+
+    return numFailed;
+}
+
+juce::String BatchRenderer::renderFile(const juce::File& file, const juce::File& outputFile, double& seconds)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr) {
+        return "not a file that can be read";
+    }
+
+    const double sampleRate = reader->sampleRate;
+    const int blockSize = 4096;
+
+    // the same chain the player uses: SlowAudioSource into the reverb, always in stereo
+    SlowAudioSource slowSource(new juce::AudioFormatReaderSource(reader.get(), false), true, (int) reader->numChannels);
+    slowSource.setQuality(options.quality);
+    slowSource.setSlowAmount(options.slowAmount);
+    slowSource.prepareToPlay(blockSize, sampleRate);
+    slowSource.setNextReadPosition(0);
+
+    juce::Reverb::Parameters params{0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f};
+    params.wetLevel = options.reverbAmount / 100;
+    params.dryLevel = 1.0f - params.wetLevel;
+
+    // the parameters are set first, so the gains start at their values instead of ramping to them
+    SimdReverb reverb;
+    reverb.setParameters(params);
+    reverb.setSampleRate(sampleRate);
+
+    outputFile.deleteFile();
+
+    std::unique_ptr<juce::FileOutputStream> stream(outputFile.createOutputStream());
+    if (stream == nullptr) {
+        return "couldn't create " + outputFile.getFullPathName();
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+    if (writer == nullptr) {
+        return "couldn't write a WAV file at this sample rate";
+    }
+    // the writer owns the stream now
+    stream.release();
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    const juce::int64 totalLength = slowSource.getTotalLength();
+
+    for (juce::int64 written = 0; written < totalLength;)
+    {
+        int numSamples = (int) juce::jmin((juce::int64) blockSize, totalLength - written);
+        juce::AudioSourceChannelInfo info(&buffer, 0, numSamples);
+        slowSource.getNextAudioBlock(info);
+        reverb.processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), numSamples);
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples)) {
+            return "couldn't write to " + outputFile.getFullPathName();
+        }
+        written += numSamples;
+    }
+
+    // the reverb keeps ringing after the last sample, so feed it silence until the tail is inaudible
+    const float tailThreshold = juce::Decibels::decibelsToGain(tailThresholdDb);
+    const juce::int64 maxLength = totalLength + (juce::int64) (maxTailSeconds * sampleRate);
+    juce::int64 renderedLength = totalLength;
+
+    while (renderedLength < maxLength)
+    {
+        int numSamples = (int) juce::jmin((juce::int64) blockSize, maxLength - renderedLength);
+        buffer.clear();
+        reverb.processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), numSamples);
+
+        if (buffer.getMagnitude(0, numSamples) < tailThreshold) {
+            break;
+        }
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples)) {
+            return "couldn't write to " + outputFile.getFullPathName();
+        }
+        renderedLength += numSamples;
+    }
+
+    slowSource.releaseResources();
+    seconds = renderedLength / sampleRate;
+    return {};
+}
+
+//==============================================================================
+bool BatchRenderer::isRenderCommand(const juce::StringArray& args)
+{
+    return args.contains("--render");
+}
+
+int BatchRenderer::runFromCommandLine(const juce::StringArray& args)
+{
+    Options options;
+    const juce::StringArray valueOptions{"--out", "--slow", "--reverb", "--threads", "--quality", "--list"};
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const juce::String& arg = args[i];
+
+        // an option without its value mustn't take the next option as its value, or be taken as a file
+        if (valueOptions.contains(arg) && (i + 1 >= args.size() || args[i + 1].startsWith("--"))) {
+            std::cerr << arg << " needs a value" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if (arg == "--render") {
+            continue;
+        } else if (arg == "--out") {
+            options.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i].unquoted());
+        } else if (arg == "--slow") {
+            options.slowAmount = args[++i].getDoubleValue();
+        } else if (arg == "--reverb") {
+            options.reverbAmount = juce::jlimit(0.0f, 100.0f, args[++i].getFloatValue());
+        } else if (arg == "--threads") {
+            options.numThreads = args[++i].getIntValue();
+        } else if (arg == "--quality") {
+            const juce::StringArray names{"duplicate", "linear", "cubic", "sinc", "keep-pitch"};
+            int index = names.indexOf(args[++i]);
+            if (index < 0) {
+                std::cerr << "Unknown quality " << args[i] << std::endl;
+                return 1;
+            }
+            options.quality = SlowAudioSource::Duplicate + index;
+        } else if (arg == "--list") {
+            juce::File listFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i].unquoted());
+            juce::StringArray lines;
+            listFile.readLines(lines);
+            for (auto& line : lines)
+            {
+                if (line.trim().isNotEmpty()) {
+                    options.files.add(listFile.getParentDirectory().getChildFile(line.trim()));
+                }
+            }
+        } else if (arg.startsWith("--")) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage();
+            return 1;
+        } else {
+            options.files.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg.unquoted()));
+        }
+    }
+
+    if (options.outputFolder == juce::File() || options.files.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+
+    if (!options.outputFolder.createDirectory()) {
+        std::cerr << "Couldn't create " << options.outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    BatchRenderer renderer(options);
+    return renderer.renderAll() == 0 ? 0 : 1;
+}
+
+void BatchRenderer::printUsage()
+{
+    std::cerr << "Usage: --render --out <folder> [--slow <percent>] [--reverb <percent>]" << std::endl
+              << "       [--quality duplicate|linear|cubic|sinc|keep-pitch] [--threads <n>]" << std::endl
+              << "       [--list <text file with one path per line>] [files...]" << std::endl;
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// This class renders files through the same slow + reverb chain as the player, straight to WAV
+// files, without a window or an audio device. Each file is streamed through a SlowAudioSource and
+// a SimdReverb a block at a time, so memory use doesn't grow with the length of the files, and the
+// files are spread across a ThreadPool so every core is busy. Rendering carries on past the end of
+// each file until the reverb tail has died away, so it isn't cut off.
+// It's started from the command line:
+//     SlowReverbPlayer --render --out <folder> [--slow <percent>] [--reverb <percent>]
+//                      [--quality duplicate|linear|cubic|sinc|keep-pitch] [--threads <n>]
+//                      [--list <text file with one path per line>] [files...]
+
+class BatchRenderer
+{
+public:
+    static constexpr float tailThresholdDb = -90.0f; // the tail is rendered until a whole block is quieter than this
+    static constexpr double maxTailSeconds = 30.0; // the longest tail that's rendered, in case the reverb never dies away
+
+    struct Options
+    {
+        juce::Array<juce::File> files;
+        juce::File outputFolder;
+        double slowAmount = 0.0; // the percentage to slow the audio by, as set on the player's slow slider
+        float reverbAmount = 0.0f; // the percentage of reverb, as set on the player's reverb slider
+        int quality = 1; // one of the SlowAudioSource::Quality values
+        int numThreads = 0; // 0 uses one thread per CPU
+    };
+
+    BatchRenderer(const Options& renderOptions);
+    ~BatchRenderer();
+
+    /**
+     *@brief Renders every file, blocking until they're all done, and prints a summary.
+     *@return  the number of files that couldn't be rendered
+     */
+    int renderAll();
+
+    /**
+     *@brief Returns true if the command line asks for a batch render instead of the player.
+     */
+    static bool isRenderCommand(const juce::StringArray& args);
+
+    /**
+     *@brief Parses the command line and renders the files it lists.
+     *@param args  the command line arguments, not including the executable
+     *@return  the value the app should exit with: 0 if every file was rendered
+     */
+    static int runFromCommandLine(const juce::StringArray& args);
+
+private:
+    Options options;
+    juce::AudioFormatManager formatManager;
+
+    /**
+     *@brief Renders one file to a WAV file.
+     *@param file  the file to render
+     *@param outputFile  the WAV file to write, which is replaced if it already exists
+     *@param seconds  set to the length of the rendered audio in seconds, including the reverb tail
+     *@return  an empty string if the file was rendered, otherwise what went wrong
+     */
+    juce::String renderFile(const juce::File& file, const juce::File& outputFile, double& seconds);
+
+    /**
+     *@brief Prints the command line options to stderr.
+     */
+    static void printUsage();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
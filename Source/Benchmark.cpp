@@ -0,0 +1,534 @@
+/*
+  ==============================================================================
+
+    Benchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "SlowAudioSource.h"
+#include "SimdReverb.h"
+#include "BpmDetector.h"
+#include "Track.h"
+#include <cmath>
+#include <iostream>
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#else
+ #include <sys/resource.h>
+#endif
+
+static const char* const qualityNames[] = { "duplicate", "linear", "cubic", "sinc", "keep-pitch" };
+static const char* const implementationNames[] = { "scalar", "SSE2", "AVX2" };
+
+static bool buffersMatch(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b, int numSamples)
+{
+    if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() < numSamples || b.getNumSamples() < numSamples) {
+        return false;
+    }
+
+    for (int channel = 0; channel < a.getNumChannels(); channel++)
+    {
+        const float* x = a.getReadPointer(channel);
+        const float* y = b.getReadPointer(channel);
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (x[i] != y[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool buffersNearlyMatch(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b, int numSamples, float tolerance)
+{
+    if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() < numSamples || b.getNumSamples() < numSamples) {
+        return false;
+    }
+
+    for (int channel = 0; channel < a.getNumChannels(); channel++)
+    {
+        const float* x = a.getReadPointer(channel);
+        const float* y = b.getReadPointer(channel);
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (std::abs(x[i] - y[i]) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the getDestIndex() MainComponent used before SlowAudioSource existed
+static int getOriginalDestIndex(int sourceSampleNum, int interval)
+{
+    int samplesToDuplicate = sourceSampleNum % interval == 0 ? sourceSampleNum / interval : sourceSampleNum / interval + 1;
+    return samplesToDuplicate * 2 + sourceSampleNum - samplesToDuplicate;
+}
+
+// the loop MainComponent::slowAudio() used to slow a file, one sample at a time
+static void renderPerSample(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest, int interval)
+{
+    dest.setSize(source.getNumChannels(), 1 + source.getNumSamples() + source.getNumSamples() / interval);
+    dest.clear();
+
+    for (int sourceSampleIX = 0; sourceSampleIX < source.getNumSamples(); sourceSampleIX++)
+    {
+        int destSampleIX = getOriginalDestIndex(sourceSampleIX, interval);
+        for (int channel = 0; channel < source.getNumChannels(); channel++)
+        {
+            dest.setSample(channel, destSampleIX, source.getSample(channel, sourceSampleIX));
+            if (sourceSampleIX % interval == 0) {
+                dest.setSample(channel, destSampleIX + 1, source.getSample(channel, sourceSampleIX));
+            }
+        }
+    }
+}
+
+// one output sample of an interpolator, worked out in double precision one tap at a time, with samples
+// outside the source read as silence. Checks the SIMD kernels in Resampler against plain arithmetic
+static float interpolateReference(const float* source, int length, double position, int quality)
+{
+    auto sample = [source, length] (juce::int64 index) { return index >= 0 && index < length ? (double) source[index] : 0.0; };
+    const juce::int64 index = (juce::int64) std::floor(position);
+    const double f = position - (double) index;
+
+    if (quality == SlowAudioSource::Linear) {
+        return (float) (sample(index) + f * (sample(index + 1) - sample(index)));
+    }
+
+    if (quality == SlowAudioSource::CubicHermite) {
+        double xm1 = sample(index - 1), x0 = sample(index), x1 = sample(index + 1), x2 = sample(index + 2);
+        double c1 = 0.5 * (x1 - xm1);
+        double c2 = xm1 - 2.5 * x0 + 2.0 * x1 - 0.5 * x2;
+        double c3 = 0.5 * (x2 - xm1) + 1.5 * (x0 - x1);
+        return (float) (((c3 * f + c2) * f + c1) * f + x0);
+    }
+
+    // the two nearest phases of the sinc table, interpolated
+    const int numTaps = 2 * Resampler::sincHalfWidth;
+    const float* table = Resampler::getSincTable().data();
+    const double phase = f * Resampler::sincPhases;
+    const int row = (int) phase;
+    double sum0 = 0.0, sum1 = 0.0;
+
+    for (int tap = 0; tap < numTaps; tap++)
+    {
+        double x = sample(index - (Resampler::sincHalfWidth - 1) + tap);
+        sum0 += x * table[row * numTaps + tap];
+        sum1 += x * table[(row + 1) * numTaps + tap];
+    }
+    return (float) (sum0 + (phase - row) * (sum1 - sum0));
+}
+
+// plays a buffer over and over up to a given length, into every channel, so a long file can be streamed
+// without holding all of it in memory
+class RepeatingAudioSource : public juce::PositionableAudioSource
+{
+public:
+    RepeatingAudioSource(const juce::AudioBuffer<float>& audio, juce::int64 totalLength)
+        : buffer(audio), length(totalLength), position(0)
+    {
+    }
+
+    void prepareToPlay(int, double) override {}
+    void releaseResources() override {}
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        for (int done = 0; done < bufferToFill.numSamples;)
+        {
+            const int offset = (int) (position % buffer.getNumSamples());
+            const int numSamples = juce::jmin(bufferToFill.numSamples - done, buffer.getNumSamples() - offset);
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); channel++)
+            {
+                bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + done, buffer,
+                                              channel % buffer.getNumChannels(), offset, numSamples);
+            }
+            done += numSamples;
+            position += numSamples;
+        }
+    }
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = newPosition; }
+    juce::int64 getNextReadPosition() const override { return position; }
+    juce::int64 getTotalLength() const override { return length; }
+    bool isLooping() const override { return false; }
+
+private:
+    const juce::AudioBuffer<float>& buffer;
+    juce::int64 length;
+    juce::int64 position;
+};
+
+// streams the whole of slowSource into a buffer, in blocks of random sizes
+static void streamInto(SlowAudioSource& slowSource, juce::AudioBuffer<float>& dest, juce::Random& random)
+{
+    for (int pos = 0; pos < dest.getNumSamples();)
+    {
+        int numSamples = juce::jmin(1 + random.nextInt(1024), dest.getNumSamples() - pos);
+        slowSource.getNextAudioBlock(juce::AudioSourceChannelInfo(&dest, pos, numSamples));
+        pos += numSamples;
+    }
+}
+
+bool Benchmark::isBenchmarkCommand(const juce::StringArray& args)
+{
+    return args.contains("--bench");
+}
+
+int Benchmark::runFromCommandLine(const juce::StringArray& args)
+{
+    std::cout << "Golden checks" << std::endl;
+    if (!runGoldenChecks()) {
+        std::cout << "Golden checks failed, so the benchmarks weren't run" << std::endl;
+        return 1;
+    }
+
+    for (double minutes : { 1.0, 10.0, 120.0 })
+    {
+        if (minutes > 10.0 && args.contains("--quick")) {
+            break;
+        }
+        runBenchmarks(minutes * 60.0);
+    }
+
+    return 0;
+}
+
+bool Benchmark::runGoldenChecks()
+{
+    const double sampleRate = 44100.0;
+    juce::AudioBuffer<float> source(2, (int) (10.0 * sampleRate));
+    fillSynthetic(source, sampleRate);
+
+    juce::Random random(1);
+    bool passed = true;
+    auto check = [&passed] (const juce::String& name, bool matches)
+    {
+        std::cout << (matches ? "  pass  " : "  FAIL  ") << name << std::endl;
+        passed = passed && matches;
+    };
+
+    // slowing must give the same samples as the original per-sample loop, whether it's streamed in blocks
+    // of any size, rendered in one go or rendered in parallel
+    juce::ThreadPool pool(juce::SystemStats::getNumCpus());
+    for (int interval : { 1, 3, 10, 100 })
+    {
+        juce::AudioBuffer<float> perSample, rendered, renderedInParallel;
+        renderPerSample(source, perSample, interval);
+        SlowAudioSource::render(source, rendered, interval);
+        SlowAudioSource::render(source, renderedInParallel, interval, &pool);
+
+        check("interval " + juce::String(interval) + ": render() matches the original per-sample loop",
+              buffersMatch(rendered, perSample, rendered.getNumSamples()));
+
+        juce::MemoryAudioSource memorySource(source, false);
+        SlowAudioSource slowSource(&memorySource, false, source.getNumChannels());
+        slowSource.setInterval(interval);
+        slowSource.prepareToPlay(512, sampleRate);
+
+        juce::AudioBuffer<float> streamed(source.getNumChannels(), rendered.getNumSamples());
+        streamInto(slowSource, streamed, random);
+
+        check("interval " + juce::String(interval) + ": streamed matches render()",
+              buffersMatch(streamed, rendered, rendered.getNumSamples()));
+        check("interval " + juce::String(interval) + ": parallel render() matches render()",
+              buffersMatch(renderedInParallel, rendered, rendered.getNumSamples()));
+    }
+
+    // unslowed audio must pass through the interpolators untouched
+    for (int quality = SlowAudioSource::Linear; quality <= SlowAudioSource::WindowedSinc; quality++)
+    {
+        juce::MemoryAudioSource memorySource(source, false);
+        SlowAudioSource slowSource(&memorySource, false, source.getNumChannels());
+        slowSource.setQuality(quality);
+        slowSource.setSlowAmount(0.0);
+        slowSource.prepareToPlay(512, sampleRate);
+        slowSource.setNextReadPosition(0);
+
+        juce::AudioBuffer<float> streamed(source.getNumChannels(), source.getNumSamples());
+        streamInto(slowSource, streamed, random);
+
+        check(juce::String(qualityNames[quality - 1]) + ": unslowed audio is unchanged",
+              buffersMatch(streamed, source, source.getNumSamples()));
+    }
+
+    // slowed audio must match the scalar reference of each interpolator, at speeds that put the
+    // positions all over the place between samples. Only rounding differences are allowed for
+    for (double percent : { 10.0, 37.0 })
+    {
+        const double speed = SlowAudioSource::getSpeedForSlowAmount(percent);
+
+        for (int quality = SlowAudioSource::Linear; quality <= SlowAudioSource::WindowedSinc; quality++)
+        {
+            juce::MemoryAudioSource memorySource(source, false);
+            SlowAudioSource slowSource(&memorySource, false, source.getNumChannels());
+            slowSource.setQuality(quality);
+            slowSource.setSlowAmount(percent);
+            slowSource.prepareToPlay(512, sampleRate);
+            slowSource.setNextReadPosition(0);
+
+            juce::AudioBuffer<float> streamed(source.getNumChannels(), (int) slowSource.getTotalLength());
+            streamInto(slowSource, streamed, random);
+
+            juce::AudioBuffer<float> expected(streamed.getNumChannels(), streamed.getNumSamples());
+            for (int channel = 0; channel < expected.getNumChannels(); channel++)
+            {
+                for (int i = 0; i < expected.getNumSamples(); i++)
+                {
+                    expected.setSample(channel, i, interpolateReference(source.getReadPointer(channel), source.getNumSamples(),
+                                                                        i * speed, quality));
+                }
+            }
+
+            check(juce::String(qualityNames[quality - 1]) + ": slowed " + juce::String((int) percent) + "% matches the scalar reference",
+                  buffersNearlyMatch(streamed, expected, expected.getNumSamples(), 1.0e-5f));
+        }
+    }
+
+    // every SIMD implementation of the reverb must sound exactly like juce::Reverb
+    juce::Reverb::Parameters params{0.8f, 0.3f, 0.6f, 0.4f, 0.7f, 0.0f};
+    for (int implementation = SimdReverb::Scalar; implementation <= SimdReverb::AVX2; implementation++)
+    {
+        SimdReverb reverb;
+        reverb.setImplementation((SimdReverb::Implementation) implementation);
+        if (reverb.getImplementation() != implementation) {
+            std::cout << "  skip  reverb: " << implementationNames[implementation - 1] << " isn't supported by this CPU" << std::endl;
+            continue;
+        }
+
+        juce::Reverb reference;
+        reverb.setParameters(params);
+        reference.setParameters(params);
+        reverb.setSampleRate(sampleRate);
+        reference.setSampleRate(sampleRate);
+
+        juce::AudioBuffer<float> expected(source), actual(source);
+        for (int pos = 0; pos < source.getNumSamples();)
+        {
+            int numSamples = juce::jmin(1 + random.nextInt(1024), source.getNumSamples() - pos);
+            reference.processStereo(expected.getWritePointer(0, pos), expected.getWritePointer(1, pos), numSamples);
+            reverb.processStereo(actual.getWritePointer(0, pos), actual.getWritePointer(1, pos), numSamples);
+            pos += numSamples;
+        }
+        check("reverb: " + juce::String(implementationNames[implementation - 1]) + " stereo matches juce::Reverb",
+              buffersMatch(actual, expected, source.getNumSamples()));
+
+        reverb.reset();
+        reference.reset();
+        reference.processMono(expected.getWritePointer(0), source.getNumSamples());
+        reverb.processMono(actual.getWritePointer(0), source.getNumSamples());
+        check("reverb: " + juce::String(implementationNames[implementation - 1]) + " mono matches juce::Reverb",
+              std::equal(expected.getReadPointer(0), expected.getReadPointer(0) + source.getNumSamples(), actual.getReadPointer(0)));
+    }
+
+    // a track that's loaded in the background and can't be read must say so once it has finished loading,
+    // so the player skips it rather than playing silence while it waits. One that can be read mustn't
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        juce::TimeSliceThread readAheadThread("Benchmark Read-Ahead");
+        readAheadThread.startThread();
+
+        juce::TemporaryFile unreadableFile(".wav"), readableFile(".wav");
+        unreadableFile.getFile().replaceWithText("not audio");
+        {
+            juce::WavAudioFormat wavFormat;
+            std::unique_ptr<juce::OutputStream> stream(readableFile.getFile().createOutputStream());
+            std::unique_ptr<juce::AudioFormatWriter> writer(stream != nullptr ? wavFormat.createWriterFor(stream.get(), sampleRate, 2, 16, {}, 0) : nullptr);
+            if (writer != nullptr) {
+                stream.release();
+                writer->writeFromAudioSampleBuffer(source, 0, source.getNumSamples());
+            }
+        }
+
+        for (bool readable : { false, true })
+        {
+            Track track(readable ? readableFile.getFile() : unreadableFile.getFile());
+            bool failedBeforeLoading = track.hasFailedToLoad();
+
+            juce::ThreadPool loadPool(1);
+            loadPool.addJob([&]
+            {
+                track.load(formatManager, Track::DecodeToMemory, readAheadThread);
+            });
+            // the message thread only ever checks, it never waits
+            while (!track.hasFinishedLoading())
+            {
+                juce::Thread::sleep(1);
+            }
+
+            check(juce::String(readable ? "track: a readable file loads" : "track: an unreadable file fails to load, and says so"),
+                  !failedBeforeLoading && track.hasFailedToLoad() != readable && track.isLoaded() == readable);
+        }
+    }
+
+    return passed;
+}
+
+void Benchmark::runBenchmarks(double seconds)
+{
+    const double sampleRate = 44100.0;
+    const juce::int64 length = (juce::int64) (seconds * sampleRate);
+
+    std::cout << std::endl << seconds / 60.0 << " min of mono audio at 44.1 kHz" << std::endl;
+
+    // at most chunkSeconds of audio, repeated to make up the length
+    juce::AudioBuffer<float> chunk(1, (int) juce::jmin(length, (juce::int64) (chunkSeconds * sampleRate)));
+    fillSynthetic(chunk, sampleRate);
+    RepeatingAudioSource source(chunk, length);
+
+    // the index maths, on its own
+    {
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        juce::int64 sum = 0;
+        for (juce::int64 i = 0; i < length; i++)
+        {
+            sum += SlowAudioSource::getDestIndex(i, 10) + SlowAudioSource::getSourceIndex(i, 10);
+        }
+        report("getDestIndex + getSourceIndex", length, sampleRate, startTicks);
+
+        // use the sum, so the loop isn't optimised away
+        if (sum == 0) {
+            std::cout << std::endl;
+        }
+    }
+
+    // rendering, slowed 10%. Longer lengths are rendered a chunk at a time, so neither the source nor
+    // the slowed audio has to be held in memory all at once
+    for (int numThreads : { 1, juce::SystemStats::getNumCpus() })
+    {
+        juce::ThreadPool pool(numThreads);
+        juce::AudioBuffer<float> dest;
+        juce::int64 numRendered = 0;
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        for (juce::int64 pos = 0; pos < length; pos += chunk.getNumSamples())
+        {
+            // the last chunk may be shorter, so it's rendered from a buffer that refers to the start of chunk
+            const int numSamples = (int) juce::jmin((juce::int64) chunk.getNumSamples(), length - pos);
+            juce::AudioBuffer<float> part(chunk.getArrayOfWritePointers(), chunk.getNumChannels(), numSamples);
+            SlowAudioSource::render(part, dest, 10, numThreads > 1 ? &pool : nullptr);
+            numRendered += dest.getNumSamples();
+        }
+        report("render(), " + juce::String(numThreads) + (numThreads > 1 ? " threads" : " thread"), numRendered, sampleRate, startTicks);
+    }
+
+    // streaming to stereo, the way the player does, slowed 10%
+    juce::AudioBuffer<float> block(2, 512);
+    for (int quality = SlowAudioSource::Duplicate; quality <= SlowAudioSource::KeepPitch; quality++)
+    {
+        source.setNextReadPosition(0);
+        SlowAudioSource slowSource(&source, false, 1);
+        slowSource.setQuality(quality);
+        slowSource.setSlowAmount(10.0);
+        slowSource.prepareToPlay(block.getNumSamples(), sampleRate);
+        slowSource.setNextReadPosition(0);
+
+        const juce::int64 totalLength = slowSource.getTotalLength();
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        for (juce::int64 pos = 0; pos < totalLength; pos += block.getNumSamples())
+        {
+            int numSamples = (int) juce::jmin((juce::int64) block.getNumSamples(), totalLength - pos);
+            slowSource.getNextAudioBlock(juce::AudioSourceChannelInfo(&block, 0, numSamples));
+        }
+        report("stream, " + juce::String(qualityNames[quality - 1]), totalLength, sampleRate, startTicks);
+    }
+
+    // the reverb, in the player's block size
+    {
+        SimdReverb reverb;
+        reverb.setParameters({0.5f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f});
+        reverb.setSampleRate(sampleRate);
+
+        source.setNextReadPosition(0);
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        for (juce::int64 pos = 0; pos < length; pos += block.getNumSamples())
+        {
+            int numSamples = (int) juce::jmin((juce::int64) block.getNumSamples(), length - pos);
+            source.getNextAudioBlock(juce::AudioSourceChannelInfo(&block, 0, numSamples));
+            reverb.processStereo(block.getWritePointer(0), block.getWritePointer(1), numSamples);
+        }
+        report("SimdReverb, " + juce::String(implementationNames[reverb.getImplementation() - 1]), length, sampleRate, startTicks);
+    }
+
+    // BPM detection, as it's run on every queued file. Reported against the length of the whole file
+    BpmDetector::ReadFunction read = [&source] (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples)
+    {
+        source.setNextReadPosition(startSample);
+        source.getNextAudioBlock(juce::AudioSourceChannelInfo(&dest, 0, numSamples));
+        return true;
+    };
+    for (bool fast : { false, true })
+    {
+        float confidence, agreement;
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        float bpm = BpmDetector::detectStreamed(read, 1, length, sampleRate, fast, confidence, agreement);
+        juce::String found = juce::String(bpm, 1) + (agreement > 0 ? ", " + juce::String(juce::roundToInt(agreement * 100.0f)) + "% agree" : juce::String());
+        report(juce::String(fast ? "BPM, fast" : "BPM") + " (found " + found + ")", length, sampleRate, startTicks);
+    }
+}
+
+void Benchmark::fillSynthetic(juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    // one beat of a kick drum over a chord whose notes are all whole numbers of cycles per beat,
+    // so the beat can just be repeated
+    const int beatLength = (int) (sampleRate * 60.0 / 120.0);
+    const double twoPi = juce::MathConstants<double>::twoPi;
+    std::vector<float> beat((size_t) beatLength);
+
+    for (int i = 0; i < beatLength; i++)
+    {
+        double t = i / sampleRate;
+        double kick = std::sin(twoPi * 55.0 * t) * std::exp(-t / 0.04);
+        double chord = std::sin(twoPi * 220.0 * t) + std::sin(twoPi * 278.0 * t) + std::sin(twoPi * 330.0 * t);
+        beat[(size_t) i] = (float) (0.6 * kick + 0.08 * chord);
+    }
+
+    // a little noise on top, different in each channel
+    juce::Random random(1234);
+    for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+    {
+        float* samples = buffer.getWritePointer(channel);
+        for (int i = 0; i < buffer.getNumSamples(); i++)
+        {
+            samples[i] = beat[(size_t) (i % beatLength)] + 0.02f * (random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+}
+
+void Benchmark::report(const juce::String& name, juce::int64 numSamples, double sampleRate, juce::int64 startTicks)
+{
+    double elapsed = juce::jmax(1.0e-9, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks));
+
+    std::cout << "  " << name.paddedRight(' ', 36)
+              << juce::String(numSamples / elapsed / 1.0e6, 1).paddedLeft(' ', 9) << " M samples/sec"
+              << juce::String(numSamples / sampleRate / elapsed, 0).paddedLeft(' ', 10) << "x realtime"
+              << juce::String(getPeakMemory() / (1024.0 * 1024.0), 0).paddedLeft(' ', 8) << " MB peak" << std::endl;
+}
+
+juce::int64 Benchmark::getPeakMemory()
+{
+   #if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (juce::int64) counters.PeakWorkingSetSize;
+    }
+    return 0;
+   #else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // macOS reports bytes, Linux reports kilobytes
+    #if JUCE_MAC || JUCE_IOS
+     return (juce::int64) usage.ru_maxrss;
+    #else
+     return (juce::int64) usage.ru_maxrss * 1024;
+    #endif
+   #endif
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// This class times the DSP the player is built on (SlowAudioSource at every quality, the
+// index maths, SimdReverb and BPM detection) on synthetic audio, without a window or an audio device.
+// It's started from the command line:
+//     SlowReverbPlayer --bench [--quick]
+// Each stage is run on 1 minute, 10 minutes and 2 hours of audio (--quick stops at 10 minutes),
+// and reported as samples/sec and realtime factor, along with the peak memory the process has used.
+// Only chunkSeconds of audio is held in memory, and it's repeated to make up the longer lengths,
+// which are streamed through each stage (and rendered a chunk at a time), so the 2 hour run uses
+// about as much memory as the 1 minute one.
+// Before anything is timed, golden checks compare the optimised code with the reference it
+// replaced: sample duplication with the original per-sample loop, sample for sample, and the
+// interpolators with plain scalar versions of their kernels. A track that can't be read is also
+// checked to report that it failed to load, which is what the player skips it on. If any check
+// fails, the run fails.
+
+class Benchmark
+{
+public:
+    static constexpr double chunkSeconds = 60.0; // the length of synthetic audio held in memory
+
+    /**
+     *@brief Returns true if the command line asks for the benchmarks instead of the player.
+     */
+    static bool isBenchmarkCommand(const juce::StringArray& args);
+
+    /**
+     *@brief Runs the golden checks and then the benchmarks, printing the results.
+     *@param args  the command line arguments, not including the executable
+     *@return  the value the app should exit with: 0 if every golden check passed
+     */
+    static int runFromCommandLine(const juce::StringArray& args);
+
+private:
+    /**
+     *@brief Checks that the streamed, parallel and SIMD code produce the same samples as their references.
+     *@return  true if every check passed
+     */
+    static bool runGoldenChecks();
+
+    /**
+     *@brief Times every stage on one length of synthetic audio.
+     */
+    static void runBenchmarks(double seconds);
+
+    /**
+     *@brief Fills buffer with a 120 BPM kick drum over a chord and some noise, the same every time.
+     */
+    static void fillSynthetic(juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    /**
+     *@brief Prints one result line.
+     *@param name  what was timed
+     *@param numSamples  the number of samples it produced (or processed)
+     *@param sampleRate  the sample rate of those samples
+     *@param startTicks  the high resolution tick count when timing started
+     */
+    static void report(const juce::String& name, juce::int64 numSamples, double sampleRate, juce::int64 startTicks);
+
+    /**
+     *@brief Returns the most memory the process has had resident at once, in bytes.
+     */
+    static juce::int64 getPeakMemory();
+};
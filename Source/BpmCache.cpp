@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    BpmCache.cpp
+
+  ==============================================================================
+*/
+
+#include "BpmCache.h"
+
+BpmCache::BpmCache(juce::File file) : cacheFile(file), dirty(false)
+{
+    loadFromDisk();
+    startTimer(saveIntervalMs);
+}
+
+BpmCache::~BpmCache()
+{
+    stopTimer();
+    saveToDisk();
+}
+
+juce::File BpmCache::getDefaultCacheFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(ProjectInfo::projectName)
+               .getChildFile("BpmCache.xml");
+}
+
+bool BpmCache::lookup(const juce::File& file, float& bpm, float& confidence, float& agreement)
+{
+    juce::String path = file.getFullPathName();
+    juce::int64 size = file.getSize();
+    juce::int64 modificationTime = file.getLastModificationTime().toMilliseconds();
+
+    juce::String savedFingerprint;
+    {
+        const juce::ScopedLock sl(lock);
+        auto it = entries.find(path);
+
+        if (it == entries.end() || it->second.size != size) {
+            return false;
+        }
+        if (it->second.modificationTime == modificationTime) {
+            bpm = it->second.bpm;
+            confidence = it->second.confidence;
+            agreement = it->second.agreement;
+            return true;
+        }
+        savedFingerprint = it->second.fingerprint;
+    }
+
+    // the file has been touched, but its audio may be the same (e.g. if it was copied back over itself).
+    // Fingerprinting it is still much quicker than detecting the BPM again
+    if (savedFingerprint.isEmpty() || getFingerprint(file) != savedFingerprint) {
+        return false;
+    }
+
+    const juce::ScopedLock sl(lock);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return false;
+    }
+    it->second.modificationTime = modificationTime;
+    bpm = it->second.bpm;
+    confidence = it->second.confidence;
+    agreement = it->second.agreement;
+    dirty = true;
+    return true;
+}
+
+void BpmCache::store(const juce::File& file, float bpm, float confidence, float agreement)
+{
+    Entry entry{ file.getSize(), file.getLastModificationTime().toMilliseconds(), getFingerprint(file), bpm, confidence, agreement };
+
+    const juce::ScopedLock sl(lock);
+    entries[file.getFullPathName()] = entry;
+    dirty = true;
+}
+
+void BpmCache::loadFromDisk()
+{
+    if (!cacheFile.existsAsFile()) {
+        return;
+    }
+
+    std::unique_ptr<juce::XmlElement> xml = juce::XmlDocument::parse(cacheFile);
+    if (xml == nullptr || !xml->hasTagName("BPMCACHE")) {
+        return;
+    }
+
+    for (auto* e : xml->getChildWithTagNameIterator("FILE"))
+    {
+        Entry entry;
+        entry.size = e->getStringAttribute("size").getLargeIntValue();
+        entry.modificationTime = e->getStringAttribute("modified").getLargeIntValue();
+        // entries saved with a hash of the whole file have no fingerprint, so they're only used while the file is untouched
+        entry.fingerprint = e->getStringAttribute("fingerprint");
+        entry.bpm = (float) e->getDoubleAttribute("bpm");
+        entry.confidence = (float) e->getDoubleAttribute("confidence");
+        // entries saved before the agreement was kept are treated as coming from the whole file
+        entry.agreement = (float) e->getDoubleAttribute("agreement");
+
+        if (entry.bpm > 0.0f) {
+            entries[e->getStringAttribute("path")] = entry;
+        }
+    }
+}
+
+void BpmCache::saveToDisk()
+{
+    juce::XmlElement xml("BPMCACHE");
+    {
+        const juce::ScopedLock sl(lock);
+        if (!dirty) {
+            return;
+        }
+        dirty = false;
+
+        for (const auto& item : entries)
+        {
+            juce::XmlElement* e = xml.createNewChildElement("FILE");
+            e->setAttribute("path", item.first);
+            e->setAttribute("size", juce::String(item.second.size));
+            e->setAttribute("modified", juce::String(item.second.modificationTime));
+            e->setAttribute("fingerprint", item.second.fingerprint);
+            e->setAttribute("bpm", item.second.bpm);
+            e->setAttribute("confidence", item.second.confidence);
+            e->setAttribute("agreement", item.second.agreement);
+        }
+    }
+
+    cacheFile.getParentDirectory().createDirectory();
+    xml.writeTo(cacheFile);
+}
+
+void BpmCache::timerCallback()
+{
+    saveToDisk();
+}
+
+juce::String BpmCache::getFingerprint(const juce::File& file)
+{
+    juce::FileInputStream stream(file);
+    if (stream.failedToOpen()) {
+        return {};
+    }
+
+    // 64-bit FNV-1a over the size and the hashed ranges
+    const juce::int64 size = stream.getTotalLength();
+    juce::uint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < 8; i++)
+    {
+        hash = (hash ^ (juce::uint8) (size >> (8 * i))) * 1099511628211ULL;
+    }
+
+    juce::HeapBlock<juce::uint8> block(fingerprintEndBytes);
+    auto hashRange = [&] (juce::int64 start, juce::int64 length)
+    {
+        if (!stream.setPosition(start)) {
+            return false;
+        }
+        while (length > 0)
+        {
+            int numRead = stream.read(block.getData(), (int) juce::jmin((juce::int64) fingerprintEndBytes, length));
+            if (numRead <= 0) {
+                return false;
+            }
+            for (int i = 0; i < numRead; i++)
+            {
+                hash = (hash ^ block[i]) * 1099511628211ULL;
+            }
+            length -= numRead;
+        }
+        return true;
+    };
+
+    // small files are hashed all the way through
+    const juce::int64 middleLength = size - 2 * (juce::int64) fingerprintEndBytes;
+    if (middleLength <= (juce::int64) fingerprintNumBlocks * fingerprintBlockBytes) {
+        return hashRange(0, size) ? juce::String::toHexString((juce::int64) hash) : juce::String();
+    }
+
+    bool ok = hashRange(0, fingerprintEndBytes);
+    for (int i = 1; i <= fingerprintNumBlocks && ok; i++)
+    {
+        ok = hashRange(fingerprintEndBytes + (middleLength - fingerprintBlockBytes) * i / (fingerprintNumBlocks + 1),
+                       fingerprintBlockBytes);
+    }
+    ok = ok && hashRange(size - fingerprintEndBytes, fingerprintEndBytes);
+
+    return ok ? juce::String::toHexString((juce::int64) hash) : juce::String();
+}
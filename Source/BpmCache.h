@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    BpmCache.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+// This class remembers the BPM detected for each file, and saves it to disk so that a file only
+// has to be run through aubio once. An entry is used as long as the file's size and modification
+// time haven't changed. If only the modification time has changed, a fingerprint of the file is
+// compared with the one taken when the BPM was detected: a hash of its size, its start and end,
+// and a few blocks spread through it, so checking a file costs the same however long it is.
+// Changes are saved to disk at most every saveIntervalMs milliseconds, and when the cache is
+// deleted. Safe to use from any thread, but must be created and deleted on the message thread.
+
+class BpmCache : private juce::Timer
+{
+public:
+    static constexpr int saveIntervalMs = 5000;
+
+    /**
+     *@brief Creates a BpmCache and loads any entries already saved in cacheFile.
+     *@param cacheFile  the file the entries are read from and saved to
+     */
+    BpmCache(juce::File cacheFile);
+    ~BpmCache() override;
+
+    /**
+     *@brief Returns the file the cache is saved to when none is given: BpmCache.xml in the
+     *user's application data folder.
+     */
+    static juce::File getDefaultCacheFile();
+
+    /**
+     *@brief Looks up the BPM of a file.
+     *@param file  the audio file
+     *@param bpm  set to the BPM detected for the file, if it's in the cache
+     *@param confidence  set to the confidence aubio gave the BPM, if the file is in the cache
+     *@param agreement  set to the fraction of sampled segments that agreed with the BPM, or 0 if the
+     *                  whole file was analysed, if the file is in the cache
+     *@return  true if the file is in the cache and hasn't changed since its BPM was detected
+     */
+    bool lookup(const juce::File& file, float& bpm, float& confidence, float& agreement);
+
+    /**
+     *@brief Adds or replaces the entry for a file. It's saved to disk with the next batch of changes.
+     */
+    void store(const juce::File& file, float bpm, float confidence, float agreement);
+
+private:
+    struct Entry
+    {
+        juce::int64 size;
+        juce::int64 modificationTime;
+        juce::String fingerprint;
+        float bpm;
+        float confidence;
+        float agreement; // 0 if the whole file was analysed
+    };
+
+    juce::CriticalSection lock;
+    juce::File cacheFile;
+    std::map<juce::String, Entry> entries; // keyed by the file's full path
+    bool dirty; // whether entries has changed since it was last saved
+
+    static constexpr int fingerprintEndBytes = 65536; // hashed from each end of the file
+    static constexpr int fingerprintNumBlocks = 8; // hashed from evenly spaced points in between
+    static constexpr int fingerprintBlockBytes = 4096;
+
+    void loadFromDisk();
+
+    /**
+     *@brief Saves the entries to disk if they've changed. The file is written without holding lock.
+     */
+    void saveToDisk();
+
+    void timerCallback() override;
+
+    /**
+     *@brief Hashes the size of a file and a fixed amount of its contents.
+     *@return  the hash as a hex string, or an empty string if the file couldn't be read
+     */
+    static juce::String getFingerprint(const juce::File& file);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BpmCache)
+};
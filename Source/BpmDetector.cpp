@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    BpmDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "BpmDetector.h"
+#include <algorithm>
+#include <vector>
+
+BpmDetector::BpmDetector(double sampleRate)
+    : hopFill(0), bestBpm(0.0f), bestConfidence(-1.0f), stableSamples(0),
+      samplesUntilConverged((juce::int64) (stableSeconds * sampleRate))
+{
+    tempo = new_aubio_tempo("default", windowSize, hopSize, (uint_t) sampleRate);
+    hopIn = new_fvec(hopSize);
+    beatOut = new_fvec(1);
+}
+
+BpmDetector::~BpmDetector()
+{
+    del_aubio_tempo(tempo);
+    del_fvec(hopIn);
+    del_fvec(beatOut);
+}
+
+void BpmDetector::process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+    const float channelGain = 1.0f / (float) juce::jmax(1, numChannels);
+    int pos = startSample;
+    const int end = startSample + numSamples;
+
+    while (pos < end && !hasConverged())
+    {
+        int numToCopy = juce::jmin((int) (hopSize - hopFill), end - pos);
+        float* dest = hopIn->data + hopFill;
+
+        // mix the channels down to mono
+        juce::FloatVectorOperations::copyWithMultiply(dest, buffer.getReadPointer(0, pos), channelGain, numToCopy);
+        for (int channel = 1; channel < numChannels; channel++)
+        {
+            juce::FloatVectorOperations::addWithMultiply(dest, buffer.getReadPointer(channel, pos), channelGain, numToCopy);
+        }
+
+        hopFill += (uint_t) numToCopy;
+        pos += numToCopy;
+
+        if (hopFill == hopSize) {
+            processHop();
+        }
+    }
+}
+
+void BpmDetector::finish()
+{
+    // the last hop is padded with silence, like aubio_source_do does at the end of a file
+    if (hopFill > 0 && !hasConverged()) {
+        juce::FloatVectorOperations::clear(hopIn->data + hopFill, (int) (hopSize - hopFill));
+        processHop();
+    }
+}
+
+bool BpmDetector::hasConverged() const
+{
+    return bestBpm > 0.0f && stableSamples >= samplesUntilConverged;
+}
+
+float BpmDetector::getBpm() const
+{
+    return bestBpm;
+}
+
+float BpmDetector::getConfidence() const
+{
+    return juce::jmax(0.0f, bestConfidence);
+}
+
+void BpmDetector::processHop()
+{
+    aubio_tempo_do(tempo, hopIn, beatOut);
+    hopFill = 0;
+
+    float bpm = aubio_tempo_get_bpm(tempo);
+    float confidence = aubio_tempo_get_confidence(tempo);
+
+    if (confidence > bestConfidence) {
+        bestConfidence = confidence;
+        bestBpm = bpm;
+    }
+
+    if (bestBpm > 0.0f && std::abs(bpm - bestBpm) <= stableTolerance) {
+        stableSamples += hopSize;
+    } else {
+        stableSamples = 0;
+    }
+}
+
+float BpmDetector::detectSampled(const ReadFunction& read, int numChannels, juce::int64 lengthInSamples,
+                                 double sampleRate, float& confidence, float& agreement)
+{
+    confidence = 0.0f;
+    agreement = 0.0f;
+
+    // only worth it if the segments cover less than half of the audio
+    const juce::int64 segmentSamples = (juce::int64) (segmentSeconds * sampleRate);
+    if (lengthInSamples < 2 * numSegments * segmentSamples) {
+        return 0.0f;
+    }
+
+    const int chunkSamples = 65536;
+    juce::AudioBuffer<float> chunk(numChannels, chunkSamples);
+    std::vector<float> bpms;
+    std::vector<float> confidences;
+
+    for (int segment = 0; segment < numSegments; segment++)
+    {
+        // segments are centred at equal spacing, which keeps them away from the intro and outro
+        juce::int64 centre = lengthInSamples * (segment + 1) / (numSegments + 1);
+        juce::int64 start = centre - segmentSamples / 2;
+        juce::int64 end = start + segmentSamples;
+
+        BpmDetector detector(sampleRate);
+        for (juce::int64 pos = start; pos < end && !detector.hasConverged(); pos += chunkSamples)
+        {
+            int numToRead = (int) juce::jmin((juce::int64) chunkSamples, end - pos);
+            if (!read(chunk, pos, numToRead)) {
+                return 0.0f;
+            }
+            detector.process(chunk, 0, numToRead);
+        }
+        detector.finish();
+
+        if (detector.getBpm() > 0.0f) {
+            bpms.push_back(detector.getBpm());
+            confidences.push_back(detector.getConfidence());
+        }
+    }
+
+    if (bpms.empty()) {
+        return 0.0f;
+    }
+
+    std::vector<float> sorted(bpms);
+    std::sort(sorted.begin(), sorted.end());
+    float median = sorted[sorted.size() / 2];
+
+    // average the estimates that agree with the median
+    float bpmSum = 0.0f;
+    float confidenceSum = 0.0f;
+    int numAgreeing = 0;
+    for (size_t i = 0; i < bpms.size(); i++)
+    {
+        if (std::abs(bpms[i] - median) <= median * segmentTolerance) {
+            bpmSum += bpms[i];
+            confidenceSum += confidences[i];
+            numAgreeing++;
+        }
+    }
+
+    agreement = (float) numAgreeing / (float) numSegments;
+    confidence = confidenceSum / (float) numAgreeing;
+
+    if (agreement < minAgreement) {
+        return 0.0f;
+    }
+    return bpmSum / (float) numAgreeing;
+}
+
+float BpmDetector::detectStreamed(const ReadFunction& read, int numChannels, juce::int64 lengthInSamples,
+                                  double sampleRate, bool fast, float& confidence, float& agreement)
+{
+    agreement = 0.0f;
+
+    if (fast) {
+        bool stopped = false;
+        ReadFunction readUntilStopped = [&read, &stopped] (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples)
+        {
+            stopped = !read(dest, startSample, numSamples);
+            return !stopped;
+        };
+        float sampledBpm = detectSampled(readUntilStopped, numChannels, lengthInSamples, sampleRate, confidence, agreement);
+        if (sampledBpm > 0.0f || stopped) {
+            return sampledBpm;
+        }
+        // the segments disagree (or the audio is short), so analyse all of it
+        agreement = 0.0f;
+    }
+
+    // read a chunk at a time, stopping as soon as the detector is sure of the bpm
+    const int chunkSamples = 65536;
+    juce::AudioBuffer<float> chunk(numChannels, chunkSamples);
+    BpmDetector detector(sampleRate);
+
+    for (juce::int64 pos = 0; pos < lengthInSamples && !detector.hasConverged(); pos += chunkSamples)
+    {
+        int numToRead = (int) juce::jmin((juce::int64) chunkSamples, lengthInSamples - pos);
+        if (!read(chunk, pos, numToRead)) {
+            confidence = 0.0f;
+            return 0.0f;
+        }
+        detector.process(chunk, 0, numToRead);
+    }
+    detector.finish();
+
+    confidence = detector.getConfidence();
+    return detector.getBpm();
+}
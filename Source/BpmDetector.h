@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    BpmDetector.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+//#include <aubio/aubio.h>
+#include <Headers/aubio.h>
+
+// This class detects the BPM of audio that is passed to it a block at a time, using aubio's tempo
+// tracker. Only the estimate with the highest confidence so far is kept, and detection stops early
+// once that estimate has agreed with the tracker for stableSeconds of audio. For long files,
+// detectSampled() only analyses a few segments spread across the file.
+
+class BpmDetector
+{
+public:
+    static constexpr uint_t windowSize = 1024;
+    static constexpr uint_t hopSize = windowSize / 4;
+    static constexpr double stableSeconds = 15.0; // how long the estimate must hold before detection stops
+    static constexpr float stableTolerance = 0.5f; // how close the tracker must stay to the estimate, in BPM
+
+    static constexpr int numSegments = 6; // number of segments analysed by detectSampled()
+    static constexpr double segmentSeconds = 20.0; // length of each segment
+    static constexpr float segmentTolerance = 0.02f; // how close a segment's estimate must be to the median to agree with it, as a fraction of the BPM
+    static constexpr float minAgreement = 0.6f; // fraction of segments that must agree for detectSampled() to give an estimate
+
+    // fills dest with numSamples samples of the audio, starting at startSample. Returns false if
+    // detection should stop straight away, e.g. because the thread running it is being stopped
+    using ReadFunction = std::function<bool(juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples)>;
+
+    BpmDetector(double sampleRate);
+    ~BpmDetector();
+
+    /**
+     *@brief Feeds audio to the tempo tracker. Channels are mixed down to mono.
+     *Does nothing once hasConverged() returns true.
+     */
+    void process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    /**
+     *@brief Passes any samples left over from the last call to process() to the tempo tracker.
+     *Call once all of the audio has been processed.
+     */
+    void finish();
+
+    /**
+     *@brief Returns true once the estimate has been stable for long enough that the rest of the audio can be skipped.
+     */
+    bool hasConverged() const;
+
+    float getBpm() const;
+    float getConfidence() const;
+
+    /**
+     *@brief Estimates the BPM from numSegments segments spread evenly across the audio.
+     *Each segment is analysed by its own BpmDetector, and the estimates that agree with their median are averaged.
+     *@param read  reads the audio
+     *@param numChannels  the number of channels read() fills
+     *@param lengthInSamples  the length of the audio
+     *@param sampleRate  the sample rate of the audio
+     *@param confidence  set to the average confidence aubio gave the agreeing segments
+     *@param agreement  set to the fraction of segments whose estimate agrees with the result
+     *@return  the BPM, or 0 if the audio is too short to be worth sampling, agreement is below minAgreement
+     *         or read() stopped the detection. In the first two cases the whole file should be analysed instead.
+     */
+    static float detectSampled(const ReadFunction& read, int numChannels, juce::int64 lengthInSamples,
+                               double sampleRate, float& confidence, float& agreement);
+
+    /**
+     *@brief Detects the BPM of audio that's read a chunk at a time, e.g. straight from a file.
+     *Reading stops as soon as the estimate has converged, so most of a long file is never read.
+     *@param read  reads the audio
+     *@param numChannels  the number of channels read() fills
+     *@param lengthInSamples  the length of the audio
+     *@param sampleRate  the sample rate of the audio
+     *@param fast  if true, detectSampled() is tried first, and the whole audio is only analysed if it gives no estimate
+     *@param confidence  set to the confidence aubio gave the BPM
+     *@param agreement  set to the fraction of segments that agreed with the BPM if it came from detectSampled(),
+     *                  or 0 if the whole audio was analysed
+     *@return  the BPM, or 0 if none was detected or read() stopped the detection
+     */
+    static float detectStreamed(const ReadFunction& read, int numChannels, juce::int64 lengthInSamples,
+                                double sampleRate, bool fast, float& confidence, float& agreement);
+
+private:
+    aubio_tempo_t* tempo;
+    fvec_t* hopIn; // the hop being filled, mixed down to mono
+    fvec_t* beatOut;
+    uint_t hopFill; // number of samples in hopIn so far
+
+    float bestBpm; // the estimate with the highest confidence so far
+    float bestConfidence;
+    juce::int64 stableSamples; // number of samples the tracker has agreed with bestBpm for
+    juce::int64 samplesUntilConverged;
+
+    void processHop();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BpmDetector)
+};
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    CallbackStats.cpp
+
+  ==============================================================================
+*/
+
+#include "CallbackStats.h"
+
+CallbackStats::CallbackStats()
+    : blockSize(0), sampleRate(0.0), deadlineTicks(0), numCallbacks(0), numOverruns(0),
+      lastLoad(0.0f), worstLoad(0.0f), resetRequested(false)
+{
+    for (auto& count : histogram)
+    {
+        count.store(0);
+    }
+}
+
+CallbackStats::~CallbackStats()
+{
+}
+
+void CallbackStats::prepare(int samplesPerBlockExpected, double newSampleRate)
+{
+    blockSize.store(samplesPerBlockExpected);
+    sampleRate.store(newSampleRate);
+
+    double deadlineSeconds = newSampleRate > 0.0 ? samplesPerBlockExpected / newSampleRate : 0.0;
+    deadlineTicks.store((juce::int64) (deadlineSeconds * (double) juce::Time::getHighResolutionTicksPerSecond()));
+
+    // loads measured against the old deadline can't be compared with the new ones
+    clear();
+}
+
+void CallbackStats::addCallback(juce::int64 startTicks)
+{
+    const juce::int64 elapsedTicks = juce::Time::getHighResolutionTicks() - startTicks;
+
+    if (resetRequested.exchange(false, std::memory_order_acquire)) {
+        clear();
+    }
+
+    const juce::int64 deadline = deadlineTicks.load(std::memory_order_relaxed);
+    if (deadline <= 0) {
+        return;
+    }
+
+    // this is the only thread that writes the counters, so they don't need read-modify-write operations
+    const float load = (float) elapsedTicks / (float) deadline;
+    const int bin = juce::jlimit(0, numBins - 1, (int) (load / binWidth));
+
+    histogram[(size_t) bin].store(histogram[(size_t) bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    numCallbacks.store(numCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (load > 1.0f) {
+        numOverruns.store(numOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    lastLoad.store(load, std::memory_order_relaxed);
+    if (load > worstLoad.load(std::memory_order_relaxed)) {
+        worstLoad.store(load, std::memory_order_relaxed);
+    }
+}
+
+void CallbackStats::reset()
+{
+    resetRequested.store(true, std::memory_order_release);
+}
+
+void CallbackStats::clear()
+{
+    for (auto& count : histogram)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    numCallbacks.store(0, std::memory_order_relaxed);
+    numOverruns.store(0, std::memory_order_relaxed);
+    lastLoad.store(0.0f, std::memory_order_relaxed);
+    worstLoad.store(0.0f, std::memory_order_relaxed);
+}
+
+CallbackStats::Snapshot CallbackStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.blockSize = blockSize.load();
+    snapshot.sampleRate = sampleRate.load();
+    snapshot.deadlineMs = snapshot.sampleRate > 0.0 ? 1000.0 * snapshot.blockSize / snapshot.sampleRate : 0.0;
+    snapshot.numCallbacks = numCallbacks.load(std::memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    snapshot.lastLoad = lastLoad.load(std::memory_order_relaxed);
+    snapshot.worstLoad = worstLoad.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < numBins; i++)
+    {
+        snapshot.histogram[(size_t) i] = histogram[(size_t) i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+juce::File CallbackStats::getDefaultDumpFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(ProjectInfo::projectName)
+               .getChildFile("CallbackStats.json");
+}
+
+//==============================================================================
+float CallbackStats::Snapshot::getLoadPercentile(double fraction) const
+{
+    juce::int64 total = 0;
+    for (auto count : histogram)
+    {
+        total += count;
+    }
+    if (total == 0) {
+        return 0.0f;
+    }
+
+    // the histogram can be a callback or two ahead of numCallbacks, so its own total is used
+    const juce::int64 target = juce::jmax((juce::int64) 1, (juce::int64) std::ceil(fraction * (double) total));
+    juce::int64 counted = 0;
+    for (int i = 0; i < numBins; i++)
+    {
+        counted += histogram[(size_t) i];
+        if (counted >= target) {
+            // the last bin has no upper edge, so the worst load stands in for it
+            return i == numBins - 1 ? worstLoad : (i + 1) * binWidth;
+        }
+    }
+    return worstLoad;
+}
+
+juce::var CallbackStats::Snapshot::toVar(int xrunCount) const
+{
+    juce::DynamicObject::Ptr json = new juce::DynamicObject();
+    json->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    json->setProperty("blockSize", blockSize);
+    json->setProperty("sampleRate", sampleRate);
+    json->setProperty("deadlineMs", deadlineMs);
+    json->setProperty("callbacks", numCallbacks);
+    json->setProperty("overruns", numOverruns);
+    json->setProperty("deviceXruns", xrunCount);
+    json->setProperty("lastLoad", lastLoad);
+    json->setProperty("worstLoad", worstLoad);
+    json->setProperty("p50Load", getLoadPercentile(0.5));
+    json->setProperty("p99Load", getLoadPercentile(0.99));
+    json->setProperty("binWidth", binWidth);
+
+    // the count of callbacks in each bin, starting from a load of 0
+    juce::Array<juce::var> bins;
+    for (auto count : histogram)
+    {
+        bins.add(count);
+    }
+    json->setProperty("histogram", bins);
+
+    return juce::var(json.get());
+}
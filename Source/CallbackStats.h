@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    CallbackStats.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// This class records how long each audio callback takes compared with its deadline: the time one
+// block of samplesPerBlockExpected samples lasts at the device's sample rate. A callback's load is
+// its duration over the deadline, so a load above 1.0 is an overrun, which the device may hear as
+// a dropout. Loads are counted in a histogram of numBins bins, each binWidth wide; the last bin
+// holds every load from its lower edge up.
+// Only the audio thread may call prepare() and addCallback(). Every counter is an atomic with a
+// single writer, so the audio thread never locks or allocates, and any other thread can read a
+// snapshot. A snapshot may mix counts from either side of a callback, which doesn't matter for telemetry.
+
+class CallbackStats
+{
+public:
+    static constexpr int numBins = 40;
+    static constexpr float binWidth = 0.05f; // 5% of the deadline, so the bins cover 0% to 200%
+
+    struct Snapshot
+    {
+        int blockSize = 0; // samplesPerBlockExpected, as given to prepare()
+        double sampleRate = 0.0;
+        double deadlineMs = 0.0; // how long one block lasts
+        juce::int64 numCallbacks = 0;
+        juce::int64 numOverruns = 0; // callbacks that took longer than the deadline
+        float lastLoad = 0.0f;
+        float worstLoad = 0.0f;
+        std::array<juce::int64, numBins> histogram{};
+
+        /**
+         *@brief Estimates a percentile of the load from the histogram.
+         *@param fraction  the fraction of callbacks that should be at or below the result, e.g. 0.99
+         *@return  the upper edge of the bin the percentile falls in, or 0 if there have been no callbacks
+         */
+        float getLoadPercentile(double fraction) const;
+
+        /**
+         *@brief Returns the snapshot as a JSON object for monitoring tools, which can have more properties
+         *added before it's written with juce::JSON::toString().
+         *@param xrunCount  the audio device's own count of xruns, or -1 if it doesn't report one
+         */
+        juce::var toVar(int xrunCount) const;
+    };
+
+    CallbackStats();
+    ~CallbackStats();
+
+    /**
+     *@brief Sets the deadline each callback is measured against. Called from prepareToPlay().
+     */
+    void prepare(int samplesPerBlockExpected, double sampleRate);
+
+    /**
+     *@brief Records one callback. Called at the end of getNextAudioBlock().
+     *@param startTicks  juce::Time::getHighResolutionTicks() at the start of the callback
+     */
+    void addCallback(juce::int64 startTicks);
+
+    /**
+     *@brief Clears the counters. Can be called from any thread; the audio thread clears them
+     *at the start of its next callback, so it stays the only writer.
+     */
+    void reset();
+
+    Snapshot getSnapshot() const;
+
+    /**
+     *@brief Returns the file the stats are dumped to when none is given: CallbackStats.json in the
+     *user's application data folder.
+     */
+    static juce::File getDefaultDumpFile();
+
+private:
+    std::atomic<int> blockSize;
+    std::atomic<double> sampleRate;
+    std::atomic<juce::int64> deadlineTicks;
+    std::atomic<juce::int64> numCallbacks;
+    std::atomic<juce::int64> numOverruns;
+    std::atomic<float> lastLoad;
+    std::atomic<float> worstLoad;
+    std::array<std::atomic<juce::int64>, numBins> histogram;
+    std::atomic<bool> resetRequested;
+
+    void clear();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackStats)
+};
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    CallbackStatsPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "CallbackStatsPanel.h"
+
+CallbackStatsPanel::CallbackStatsPanel(CallbackStats& statsToShow, std::function<int()> xrunCounter,
+                                       ConvolutionReverb* convolutionToShow)
+    : stats(statsToShow), getXrunCount(std::move(xrunCounter)), convolution(convolutionToShow),
+      convolutionLoad(-1.0f), peakConvolutionLoad(0.0f), ticksUntilDump(dumpInterval * refreshHz)
+{
+    addAndMakeVisible(&resetButton);
+    resetButton.setButtonText("Reset");
+    resetButton.onClick = [this]
+    {
+        stats.reset();
+        if (convolution != nullptr) {
+            convolution->resetPeakCpuLoad();
+        }
+    };
+
+    addAndMakeVisible(&dumpButton);
+    dumpButton.setButtonText("Dump JSON");
+    dumpButton.setTooltip(CallbackStats::getDefaultDumpFile().getFullPathName());
+    dumpButton.onClick = [this] { dump(CallbackStats::getDefaultDumpFile()); };
+
+    startTimerHz(refreshHz);
+}
+
+CallbackStatsPanel::~CallbackStatsPanel()
+{
+    stopTimer();
+}
+
+void CallbackStatsPanel::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().withTrimmedRight(resetButton.getWidth() + 10);
+    auto textArea = bounds.removeFromTop(16);
+    auto convolutionArea = convolution != nullptr ? bounds.removeFromTop(16) : juce::Rectangle<int>();
+
+    auto percent = [] (float load) { return juce::String(juce::roundToInt(load * 100.0f)) + "%"; };
+    int xruns = getXrunCount != nullptr ? getXrunCount() : -1;
+
+    juce::String text = "Callback load " + percent(snapshot.lastLoad)
+                      + "  p50 " + percent(snapshot.getLoadPercentile(0.5))
+                      + "  p99 " + percent(snapshot.getLoadPercentile(0.99))
+                      + "  worst " + percent(snapshot.worstLoad)
+                      + "  overruns " + juce::String(snapshot.numOverruns) + "/" + juce::String(snapshot.numCallbacks)
+                      + (xruns >= 0 ? "  xruns " + juce::String(xruns) : juce::String());
+
+    g.setColour(snapshot.numOverruns > 0 ? newRed : blackGrey);
+    g.setFont(13.0f);
+    g.drawText(text, textArea, juce::Justification::centredLeft, true);
+
+    if (convolution != nullptr) {
+        g.setColour(blackGrey);
+        g.drawText(convolutionLoad >= 0.0f ? "Convolution load " + percent(convolutionLoad) + "  peak " + percent(peakConvolutionLoad)
+                                           : juce::String("Convolution off"),
+                   convolutionArea, juce::Justification::centredLeft, true);
+    }
+
+    // the histogram, with bar heights on a square root scale so the rare slow callbacks still show up
+    g.setColour(grey);
+    g.drawRect(bounds);
+    auto plot = bounds.reduced(1).toFloat();
+
+    juce::int64 maxCount = 1;
+    for (auto count : snapshot.histogram)
+    {
+        maxCount = juce::jmax(maxCount, count);
+    }
+
+    const float barWidth = plot.getWidth() / CallbackStats::numBins;
+    for (int i = 0; i < CallbackStats::numBins; i++)
+    {
+        if (snapshot.histogram[(size_t) i] == 0) {
+            continue;
+        }
+        float height = plot.getHeight() * std::sqrt((float) snapshot.histogram[(size_t) i] / (float) maxCount);
+        bool overran = (i + 1) * CallbackStats::binWidth > 1.0f;
+        g.setColour(overran ? newRed : newGreen);
+        g.fillRect(plot.getX() + i * barWidth, plot.getBottom() - height, juce::jmax(1.0f, barWidth - 1.0f), height);
+    }
+
+    // the deadline
+    g.setColour(newRed);
+    float deadlineX = plot.getX() + plot.getWidth() / (CallbackStats::numBins * CallbackStats::binWidth);
+    g.drawVerticalLine(juce::roundToInt(deadlineX), plot.getY(), plot.getBottom());
+}
+
+void CallbackStatsPanel::resized()
+{
+    auto buttonArea = getLocalBounds().removeFromRight(90);
+    resetButton.setBounds(buttonArea.removeFromTop(getHeight() / 2).reduced(0, 2));
+    dumpButton.setBounds(buttonArea.reduced(0, 2));
+}
+
+bool CallbackStatsPanel::dump(const juce::File& file)
+{
+    int xruns = getXrunCount != nullptr ? getXrunCount() : -1;
+    juce::var json = stats.getSnapshot().toVar(xruns);
+
+    if (convolution != nullptr && convolution->hasImpulseResponse()) {
+        json.getDynamicObject()->setProperty("convolutionLoad", convolution->getCpuLoad());
+        json.getDynamicObject()->setProperty("peakConvolutionLoad", convolution->getPeakCpuLoad());
+    }
+    return file.getParentDirectory().createDirectory() && file.replaceWithText(juce::JSON::toString(json));
+}
+
+void CallbackStatsPanel::timerCallback()
+{
+    snapshot = stats.getSnapshot();
+    if (convolution != nullptr) {
+        convolutionLoad = convolution->hasImpulseResponse() ? convolution->getCpuLoad() : -1.0f;
+        peakConvolutionLoad = convolution->getPeakCpuLoad();
+    }
+    repaint();
+
+    if (--ticksUntilDump <= 0) {
+        ticksUntilDump = dumpInterval * refreshHz;
+        if (snapshot.numCallbacks > 0) {
+            dump(CallbackStats::getDefaultDumpFile());
+        }
+    }
+}
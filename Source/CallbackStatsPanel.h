@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    CallbackStatsPanel.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CallbackStats.h"
+#include "ConvolutionReverb.h"
+
+// This class shows a CallbackStats on screen: the last, median, 99th percentile and worst callback
+// loads, the overrun counts, and the load histogram with the deadline marked in red. If it's given
+// a ConvolutionReverb, the reverb's own share of the load is shown under them.
+// Every dumpInterval seconds it also writes the stats to CallbackStats::getDefaultDumpFile(), so
+// monitoring tools can pick them up without the app having to do anything else.
+
+class CallbackStatsPanel : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int refreshHz = 10;
+    static constexpr int dumpInterval = 10;
+
+    /**
+     *@param statsToShow  the stats to show, which must outlive the panel
+     *@param xrunCounter  returns the audio device's own count of xruns, or -1 if it doesn't report one
+     *@param convolutionToShow  the convolution reverb whose load is shown, or nullptr. Must outlive the panel
+     */
+    CallbackStatsPanel(CallbackStats& statsToShow, std::function<int()> xrunCounter,
+                       ConvolutionReverb* convolutionToShow = nullptr);
+    ~CallbackStatsPanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    /**
+     *@brief Writes the current stats to a JSON file.
+     *@return  true if the file was written
+     */
+    bool dump(const juce::File& file);
+
+private:
+    CallbackStats& stats;
+    std::function<int()> getXrunCount;
+    ConvolutionReverb* convolution;
+    CallbackStats::Snapshot snapshot;
+    float convolutionLoad; // -1 if the convolution reverb isn't in use
+    float peakConvolutionLoad;
+    int ticksUntilDump;
+
+    juce::TextButton resetButton;
+    juce::TextButton dumpButton;
+
+    juce::Colour grey = juce::Colour::fromFloatRGBA(0.42f, 0.42f, 0.42f, 1.0f);
+    juce::Colour blackGrey = juce::Colour::fromFloatRGBA(0.2f, 0.2f, 0.2f, 1.0f);
+    juce::Colour newGreen = juce::Colour::fromRGB(62, 218, 121);
+    juce::Colour newRed = juce::Colour::fromRGB(249, 62, 59);
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackStatsPanel)
+};
@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "ConvolutionReverb.h"
+
+ConvolutionReverb::ConvolutionReverb()
+    : hasEngine(false), impulseSampleRate(44100.0), sampleRate(44100.0), wet(0.0f), dry(1.0f), cpuLoad(0.0f), peakCpuLoad(0.0f)
+{
+}
+
+ConvolutionReverb::~ConvolutionReverb()
+{
+}
+
+bool ConvolutionReverb::loadImpulseResponse(const juce::File& file, juce::AudioFormatManager& formatManager)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr) {
+        return false;
+    }
+
+    int length = (int) juce::jmin(reader->lengthInSamples, (juce::int64) (maxImpulseSeconds * reader->sampleRate));
+    juce::AudioBuffer<float> buffer(juce::jmin(2, (int) reader->numChannels), length);
+    reader->read(&buffer, 0, length, 0, true, true);
+
+    setImpulseResponse(buffer, reader->sampleRate);
+    return true;
+}
+
+void ConvolutionReverb::setImpulseResponse(const juce::AudioBuffer<float>& newImpulse, double newImpulseSampleRate)
+{
+    const juce::ScopedLock sl(impulseLock);
+    impulse.makeCopyOf(newImpulse);
+    impulseSampleRate = newImpulseSampleRate;
+    rebuildEngine();
+}
+
+void ConvolutionReverb::clearImpulseResponse()
+{
+    const juce::ScopedLock sl(impulseLock);
+    impulse.setSize(0, 0);
+    rebuildEngine();
+}
+
+bool ConvolutionReverb::hasImpulseResponse() const
+{
+    return hasEngine.load();
+}
+
+void ConvolutionReverb::setSampleRate(double newSampleRate)
+{
+    const juce::ScopedLock sl(impulseLock);
+    wetGain.reset(newSampleRate, 0.01);
+    dryGain.reset(newSampleRate, 0.01);
+    wetGain.setCurrentAndTargetValue(wet.load());
+    dryGain.setCurrentAndTargetValue(dry.load());
+    
+    if (newSampleRate != sampleRate.load()) {
+        sampleRate.store(newSampleRate);
+        rebuildEngine();
+    }
+}
+
+void ConvolutionReverb::setLevels(float wetLevel, float dryLevel)
+{
+    wet.store(wetLevel);
+    dry.store(dryLevel);
+}
+
+void ConvolutionReverb::processStereo(float* left, float* right, int numSamples)
+{
+    float* channels[] = { left, right };
+    processChannels(channels, 2, numSamples);
+}
+
+void ConvolutionReverb::processMono(float* samples, int numSamples)
+{
+    processChannels(&samples, 1, numSamples);
+}
+
+float ConvolutionReverb::getCpuLoad() const
+{
+    return cpuLoad.load();
+}
+
+float ConvolutionReverb::getPeakCpuLoad() const
+{
+    return peakCpuLoad.load();
+}
+
+void ConvolutionReverb::resetPeakCpuLoad()
+{
+    peakCpuLoad.store(0.0f);
+}
+
+//==============================================================================
+void ConvolutionReverb::rebuildEngine()
+{
+    std::unique_ptr<Engine> newEngine;
+    const double currentSampleRate = sampleRate.load();
+
+    if (impulse.getNumChannels() > 0 && impulse.getNumSamples() > 0) {
+        const int numImpulseChannels = impulse.getNumChannels();
+
+        // resample the impulse response to the playback rate
+        double ratio = impulseSampleRate / currentSampleRate;
+        int length = (int) juce::jmin(impulse.getNumSamples() / ratio, maxImpulseSeconds * currentSampleRate);
+        juce::AudioBuffer<float> resampled(numImpulseChannels, juce::jmax(1, length));
+
+        for (int channel = 0; channel < numImpulseChannels; channel++)
+        {
+            const float* in = impulse.getReadPointer(channel);
+            float* out = resampled.getWritePointer(channel);
+
+            for (int i = 0; i < resampled.getNumSamples(); i++)
+            {
+                double pos = i * ratio;
+                int index = (int) pos;
+                float frac = (float) (pos - index);
+                float a = index < impulse.getNumSamples() ? in[index] : 0.0f;
+                float b = index + 1 < impulse.getNumSamples() ? in[index + 1] : 0.0f;
+                out[i] = a + frac * (b - a);
+            }
+        }
+
+        // normalise so that the loudest channel has unit energy, which keeps loud impulse responses from clipping
+        float maxEnergy = 0.0f;
+        for (int channel = 0; channel < numImpulseChannels; channel++)
+        {
+            const float* data = resampled.getReadPointer(channel);
+            float energy = 0.0f;
+            for (int i = 0; i < resampled.getNumSamples(); i++)
+            {
+                energy += data[i] * data[i];
+            }
+            maxEnergy = juce::jmax(maxEnergy, energy);
+        }
+        if (maxEnergy > 0.0f) {
+            for (int channel = 0; channel < numImpulseChannels; channel++) {
+                juce::FloatVectorOperations::multiply(resampled.getWritePointer(channel), 1.0f / std::sqrt(maxEnergy),
+                                                      resampled.getNumSamples());
+            }
+        }
+
+        // the tail stage spreads its work over the next block, so it has a latency of two tail partitions.
+        // It takes over from the head stage at the point in the impulse response where that lines up with
+        // the head stage's latency
+        const int headLength = 2 * tailPartitionSize - headPartitionSize;
+        const int resampledLength = resampled.getNumSamples();
+        newEngine.reset(new Engine());
+
+        for (int channel = 0; channel < 2; channel++)
+        {
+            const float* data = resampled.getReadPointer(channel % numImpulseChannels);
+            newEngine->stages[channel].emplace_back(new Stage(data, juce::jmin(resampledLength, headLength), headPartitionSize, false));
+
+            if (resampledLength > headLength) {
+                newEngine->stages[channel].emplace_back(new Stage(data + headLength, resampledLength - headLength,
+                                                                   tailPartitionSize, true));
+            }
+        }
+        newEngine->wetBuffer.resize(tailPartitionSize);
+    }
+
+    // swap the engines, and delete the old one after the audio thread has let go of the lock
+    const juce::ScopedLock sl(lock);
+    std::swap(engine, newEngine);
+    hasEngine.store(engine != nullptr);
+}
+
+void ConvolutionReverb::processChannels(float* const* channels, int numChannels, int numSamples)
+{
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+
+    {
+        // if the engine is being swapped, leave this block dry rather than wait
+        const juce::ScopedTryLock sl(lock);
+        if (!sl.isLocked() || engine == nullptr) {
+            return;
+        }
+
+        // the levels ramp linearly across the block, so changing them doesn't click
+        wetGain.setTargetValue(wet.load());
+        dryGain.setTargetValue(dry.load());
+        const float wetStart = wetGain.getCurrentValue();
+        const float dryStart = dryGain.getCurrentValue();
+        wetGain.skip(numSamples);
+        dryGain.skip(numSamples);
+        const float wetStep = numSamples > 0 ? (wetGain.getCurrentValue() - wetStart) / numSamples : 0.0f;
+        const float dryStep = numSamples > 0 ? (dryGain.getCurrentValue() - dryStart) / numSamples : 0.0f;
+
+        const int chunkSize = (int) engine->wetBuffer.size();
+        float* wetData = engine->wetBuffer.data();
+
+        for (int channel = 0; channel < juce::jmin(2, numChannels); channel++)
+        {
+            for (int pos = 0; pos < numSamples; pos += chunkSize)
+            {
+                int numToProcess = juce::jmin(chunkSize, numSamples - pos);
+                float* data = channels[channel] + pos;
+
+                juce::FloatVectorOperations::clear(wetData, numToProcess);
+                for (auto& stage : engine->stages[channel])
+                {
+                    stage->process(data, wetData, numToProcess);
+                }
+
+                for (int i = 0; i < numToProcess; i++)
+                {
+                    data[i] = data[i] * (dryStart + dryStep * (pos + i)) + wetData[i] * (wetStart + wetStep * (pos + i));
+                }
+            }
+        }
+    }
+
+    // report the time taken as a fraction of the time the block lasts for
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    float load = numSamples > 0 ? (float) (seconds * sampleRate.load() / numSamples) : 0.0f;
+    cpuLoad.store(load);
+    if (load > peakCpuLoad.load()) {
+        peakCpuLoad.store(load);
+    }
+}
+
+//==============================================================================
+ConvolutionReverb::Stage::Stage(const float* impulseData, int impulseLength, int size, bool spread)
+    : partitionSize(size), numBins(size + 1), numPartitions(juce::jmax(1, (impulseLength + size - 1) / size)),
+      spreadWork(spread), fft(2 * size), delayLinePos(0), fill(0), accumulatorPos(0), partitionsDone(numPartitions)
+{
+    impulseSpectra.resize((size_t) (numPartitions * numBins));
+    delayLine.resize((size_t) (numPartitions * numBins));
+    inputWindow.assign((size_t) (2 * partitionSize), 0.0f);
+    outputBlock.assign((size_t) partitionSize, 0.0f);
+    fftBuffer.resize((size_t) (2 * partitionSize));
+    accumulator.resize((size_t) numBins);
+
+    // each partition of the impulse response is zero-padded to the fft size and transformed once, up front
+    for (int partition = 0; partition < numPartitions; partition++)
+    {
+        std::fill(fftBuffer.begin(), fftBuffer.end(), std::complex<float>());
+        int start = partition * partitionSize;
+        int length = juce::jmin(partitionSize, impulseLength - start);
+
+        for (int i = 0; i < length; i++)
+        {
+            fftBuffer[i] = impulseData[start + i];
+        }
+        fft.perform(fftBuffer.data(), false);
+        std::copy(fftBuffer.begin(), fftBuffer.begin() + numBins, impulseSpectra.begin() + partition * numBins);
+    }
+}
+
+void ConvolutionReverb::Stage::process(const float* input, float* output, int numSamples)
+{
+    int pos = 0;
+
+    while (pos < numSamples)
+    {
+        int numToCopy = juce::jmin(partitionSize - fill, numSamples - pos);
+
+        juce::FloatVectorOperations::copy(inputWindow.data() + partitionSize + fill, input + pos, numToCopy);
+        juce::FloatVectorOperations::add(output + pos, outputBlock.data() + fill, numToCopy);
+
+        fill += numToCopy;
+        pos += numToCopy;
+
+        if (spreadWork) {
+            // keep the last block's partitions in step with how much of this block has arrived
+            accumulate(numPartitions * fill / partitionSize);
+        }
+
+        if (fill == partitionSize) {
+            processBlock();
+            fill = 0;
+        }
+    }
+}
+
+void ConvolutionReverb::Stage::processBlock()
+{
+    const int fftSize = 2 * partitionSize;
+
+    if (spreadWork) {
+        // the last block's output has to be finished before its partitions start being overwritten
+        accumulate(numPartitions);
+        transformAccumulator();
+    }
+
+    for (int i = 0; i < fftSize; i++)
+    {
+        fftBuffer[i] = inputWindow[i];
+    }
+    fft.perform(fftBuffer.data(), false);
+    std::copy(fftBuffer.begin(), fftBuffer.begin() + numBins, delayLine.begin() + delayLinePos * numBins);
+
+    std::fill(accumulator.begin(), accumulator.end(), std::complex<float>());
+    accumulatorPos = delayLinePos;
+    partitionsDone = 0;
+
+    if (!spreadWork) {
+        accumulate(numPartitions);
+        transformAccumulator();
+    }
+
+    std::copy(inputWindow.begin() + partitionSize, inputWindow.end(), inputWindow.begin());
+    delayLinePos = (delayLinePos + 1) % numPartitions;
+}
+
+void ConvolutionReverb::Stage::accumulate(int numToDo)
+{
+    // the k-th partition of the impulse response is applied to the block of input from k blocks ago
+    for (; partitionsDone < numToDo; partitionsDone++)
+    {
+        int block = accumulatorPos - partitionsDone;
+        if (block < 0) {
+            block += numPartitions;
+        }
+
+        const std::complex<float>* x = delayLine.data() + block * numBins;
+        const std::complex<float>* h = impulseSpectra.data() + partitionsDone * numBins;
+
+        for (int bin = 0; bin < numBins; bin++)
+        {
+            accumulator[bin] += std::complex<float>(x[bin].real() * h[bin].real() - x[bin].imag() * h[bin].imag(),
+                                                    x[bin].real() * h[bin].imag() + x[bin].imag() * h[bin].real());
+        }
+    }
+}
+
+void ConvolutionReverb::Stage::transformAccumulator()
+{
+    const int fftSize = 2 * partitionSize;
+
+    // the input is real, so the upper half of the spectrum mirrors the lower half
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        fftBuffer[bin] = accumulator[bin];
+    }
+    for (int bin = numBins; bin < fftSize; bin++)
+    {
+        fftBuffer[bin] = std::conj(accumulator[fftSize - bin]);
+    }
+    fft.perform(fftBuffer.data(), true);
+
+    // with overlap-save, only the second half of the result is free of wrap-around
+    for (int i = 0; i < partitionSize; i++)
+    {
+        outputBlock[i] = fftBuffer[partitionSize + i].real();
+    }
+}
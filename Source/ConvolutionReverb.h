@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <vector>
+#include "FFT.h"
+
+// This class is a reverb that convolves the audio with an impulse response loaded from a file.
+// It can be used in place of juce::Reverb, and has the same processStereo()/processMono() calls.
+// The convolution is done with partitioned overlap-save FFT convolution in two stages: the start
+// of the impulse response is split into short partitions, so the latency is only headPartitionSize
+// samples, and the rest is split into long partitions, which makes multi-second tails cheap. The
+// long partitions' work is spread over the callbacks of a whole partition, so the load stays even.
+
+class ConvolutionReverb
+{
+public:
+    static constexpr int headPartitionSize = 256; // also the latency of the reverb, in samples
+    static constexpr int tailPartitionSize = 4096;
+    static constexpr double maxImpulseSeconds = 20.0; // longer impulse responses are cut short
+
+    ConvolutionReverb();
+    ~ConvolutionReverb();
+
+    /**
+     *@brief Reads an impulse response from a file and starts using it.
+     *@param file  the audio file holding the impulse response (mono or stereo)
+     *@param formatManager  the format manager used to read the file
+     *@return  true if the file could be read
+     */
+    bool loadImpulseResponse(const juce::File& file, juce::AudioFormatManager& formatManager);
+
+    /**
+     *@brief Starts using an impulse response. It is resampled to the playback sample rate and normalised.
+     *Can be called while audio is being processed.
+     */
+    void setImpulseResponse(const juce::AudioBuffer<float>& impulse, double impulseSampleRate);
+
+    /**
+     *@brief Stops using the impulse response, so hasImpulseResponse() returns false.
+     */
+    void clearImpulseResponse();
+
+    /**
+     *@brief Returns true if an impulse response is being used. Never blocks, so it's safe to call on the audio thread.
+     */
+    bool hasImpulseResponse() const;
+
+    /**
+     *@brief Sets the sample rate the audio will be processed at. Call before processing.
+     */
+    void setSampleRate(double newSampleRate);
+
+    /**
+     *@brief Sets the levels of the reverberated and unprocessed signals, as used by juce::Reverb::Parameters.
+     *Can be called from any thread. The levels ramp to their new values over a few milliseconds.
+     */
+    void setLevels(float wetLevel, float dryLevel);
+
+    void processStereo(float* left, float* right, int numSamples);
+    void processMono(float* samples, int numSamples);
+
+    /**
+     *@brief Returns how much of the last block's duration was spent processing it (1.0 means all of it).
+     */
+    float getCpuLoad() const;
+
+    /**
+     *@brief Returns the highest value getCpuLoad() has reached since resetPeakCpuLoad() was last called.
+     */
+    float getPeakCpuLoad() const;
+    void resetPeakCpuLoad();
+
+private:
+    //==============================================================================
+    // Uniformly partitioned overlap-save convolution of one channel with one section of the
+    // impulse response. The output is delayed by partitionSize samples, or by 2 * partitionSize
+    // if spreadWork is set. Then each block's multiply-accumulate over the partitions is done a
+    // little at a time while the next block arrives, instead of all in the callback that completes
+    // the block; only its two FFTs are still done there.
+    class Stage
+    {
+    public:
+        Stage(const float* impulse, int impulseLength, int partitionSize, bool spreadWork);
+
+        /**
+         *@brief Adds the convolved input to output.
+         */
+        void process(const float* input, float* output, int numSamples);
+
+    private:
+        const int partitionSize;
+        const int numBins;
+        int numPartitions;
+        const bool spreadWork;
+        FFT fft;
+
+        std::vector<std::complex<float>> impulseSpectra; // the spectrum of each partition of the impulse response
+        std::vector<std::complex<float>> delayLine; // the spectra of the last numPartitions blocks of input
+        int delayLinePos;
+
+        std::vector<float> inputWindow; // the previous block of input followed by the current one
+        std::vector<float> outputBlock; // the output for the last complete block of input
+        int fill; // number of samples of the current block received so far
+
+        std::vector<std::complex<float>> fftBuffer;
+        std::vector<std::complex<float>> accumulator; // the spectrum of the output for the block at accumulatorPos
+        int accumulatorPos;
+        int partitionsDone; // number of partitions added to accumulator so far
+
+        void processBlock();
+
+        /**
+         *@brief Adds partitions to accumulator until numToDo of them have been added.
+         */
+        void accumulate(int numToDo);
+
+        /**
+         *@brief Transforms accumulator back to the time domain and puts the result in outputBlock.
+         */
+        void transformAccumulator();
+    };
+
+    //==============================================================================
+    // Everything needed to convolve the audio with one impulse response
+    struct Engine
+    {
+        std::vector<std::unique_ptr<Stage>> stages[2]; // for each output channel
+        std::vector<float> wetBuffer;
+    };
+
+    juce::CriticalSection lock; // held while engine is used or replaced. The audio thread never waits for it
+    std::unique_ptr<Engine> engine;
+    std::atomic<bool> hasEngine; // whether engine is set, so it can be checked without taking lock
+
+    juce::CriticalSection impulseLock; // held while impulse is used or the engine is rebuilt
+    juce::AudioBuffer<float> impulse;
+    double impulseSampleRate;
+    std::atomic<double> sampleRate;
+
+    std::atomic<float> wet;
+    std::atomic<float> dry;
+    juce::SmoothedValue<float> wetGain, dryGain; // only used on the audio thread
+    std::atomic<float> cpuLoad;
+    std::atomic<float> peakCpuLoad;
+
+    /**
+     *@brief Builds an engine for impulse at sampleRate and swaps it in. impulseLock must be held.
+     */
+    void rebuildEngine();
+
+    void processChannels(float* const* channels, int numChannels, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionReverb)
+};
@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.cpp
+
+  ==============================================================================
+*/
+
+#include "DecodedAudioCache.h"
+
+DecodedAudioCache::DecodedAudioCache(juce::int64 maxSizeInBytes) : maxSize(maxSizeInBytes), currentSize(0)
+{
+}
+
+DecodedAudioCache::~DecodedAudioCache()
+{
+}
+
+void DecodedAudioCache::setMaxSize(juce::int64 maxSizeInBytes)
+{
+    const juce::ScopedLock sl(lock);
+    maxSize = maxSizeInBytes;
+    removeOldEntries();
+}
+
+std::shared_ptr<juce::AudioBuffer<float>> DecodedAudioCache::get(const juce::File& file)
+{
+    juce::String key = getKey(file);
+    const juce::ScopedLock sl(lock);
+
+    for (auto it = entries.begin(); it != entries.end(); it++)
+    {
+        if (it->key == key) {
+            // move the entry to the front, since it's now the most recently used
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().buffer;
+        }
+    }
+
+    return nullptr;
+}
+
+void DecodedAudioCache::add(const juce::File& file, std::shared_ptr<juce::AudioBuffer<float>> buffer)
+{
+    juce::int64 size = (juce::int64) buffer->getNumChannels() * buffer->getNumSamples() * (juce::int64) sizeof(float);
+    juce::String key = getKey(file);
+    bool notify = false;
+    {
+        const juce::ScopedLock sl(lock);
+
+        // replace the file's old entry, if it has one
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->key == key) {
+                currentSize -= it->size;
+                entries.erase(it);
+                break;
+            }
+        }
+
+        if (size <= maxSize) {
+            entries.push_front({ key, buffer, size });
+            currentSize += size;
+            removeOldEntries();
+        }
+
+        // the buffer is passed on directly, since it may have been too big to keep
+        auto decode = decodes.find(file.getFullPathName());
+        if (decode != decodes.end()) {
+            notify = decode->second.waiting;
+            decode->second.waiting = false;
+            if (--decode->second.numDecoders == 0) {
+                decodes.erase(decode);
+            }
+        }
+    }
+
+    if (notify && onDecodingFinished) {
+        onDecodingFinished(file, buffer);
+    }
+}
+
+juce::int64 DecodedAudioCache::getSize() const
+{
+    const juce::ScopedLock sl(lock);
+    return currentSize;
+}
+
+void DecodedAudioCache::startDecoding(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+    decodes[file.getFullPathName()].numDecoders++;
+}
+
+void DecodedAudioCache::cancelDecoding(const juce::File& file)
+{
+    bool notify = false;
+    {
+        const juce::ScopedLock sl(lock);
+        auto decode = decodes.find(file.getFullPathName());
+        if (decode == decodes.end()) {
+            return;
+        }
+
+        // only give up waiting once no other decode of the file is left to finish
+        if (--decode->second.numDecoders == 0) {
+            notify = decode->second.waiting;
+            decodes.erase(decode);
+        }
+    }
+
+    if (notify && onDecodingFinished) {
+        onDecodingFinished(file, nullptr);
+    }
+}
+
+bool DecodedAudioCache::waitForDecoding(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+    auto decode = decodes.find(file.getFullPathName());
+    if (decode == decodes.end()) {
+        return false;
+    }
+    decode->second.waiting = true;
+    return true;
+}
+
+juce::String DecodedAudioCache::getKey(const juce::File& file)
+{
+    // if the file is changed, its size or modification time will be too, so the old entry won't match
+    return file.getFullPathName() + "|" + juce::String(file.getSize()) + "|"
+           + juce::String(file.getLastModificationTime().toMilliseconds());
+}
+
+void DecodedAudioCache::removeOldEntries()
+{
+    while (currentSize > maxSize && !entries.empty())
+    {
+        currentSize -= entries.back().size;
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <functional>
+
+// This class keeps the decoded audio of recently played files, so a file that is queued again
+// can be played without decoding it a second time. Entries are keyed by the file's path, size and
+// modification time, and the least recently used entries are dropped once the cache holds more
+// than its maximum size. The cache also knows which files are still being decoded, so anything else
+// that needs a file's audio can wait for the decode to finish instead of decoding the file again.
+// Safe to use from any thread.
+
+class DecodedAudioCache
+{
+public:
+    DecodedAudioCache(juce::int64 maxSizeInBytes);
+    ~DecodedAudioCache();
+
+    /**
+     *@brief Sets the most memory the cached buffers can use, dropping entries if needed.
+     */
+    void setMaxSize(juce::int64 maxSizeInBytes);
+
+    /**
+     *@brief Returns the cached audio for a file and marks it as the most recently used.
+     *@param file  the file to look up
+     *@return  the decoded audio, or nullptr if the file isn't cached or has changed since it was cached
+     */
+    std::shared_ptr<juce::AudioBuffer<float>> get(const juce::File& file);
+
+    /**
+     *@brief Adds a file's fully decoded audio to the cache.
+     *The buffer mustn't be modified after it has been added.
+     */
+    void add(const juce::File& file, std::shared_ptr<juce::AudioBuffer<float>> buffer);
+
+    /**
+     *@brief Returns the memory used by the cached buffers, in bytes.
+     */
+    juce::int64 getSize() const;
+
+    /**
+     *@brief Records that a file has started being decoded. Must be followed by either add() or cancelDecoding().
+     */
+    void startDecoding(const juce::File& file);
+
+    /**
+     *@brief Records that a file stopped being decoded before it was finished.
+     */
+    void cancelDecoding(const juce::File& file);
+
+    /**
+     *@brief If a file is being decoded, makes sure onDecodingFinished is called once it's done.
+     *@return  true if the file is being decoded, false if onDecodingFinished won't be called for it
+     */
+    bool waitForDecoding(const juce::File& file);
+
+    // called once a file that waitForDecoding() was called for has been decoded, with its audio, or with
+    // nullptr if every decode of the file was cancelled. Called on whichever thread finished the decode,
+    // which may be the message thread
+    std::function<void(const juce::File&, std::shared_ptr<juce::AudioBuffer<float>>)> onDecodingFinished;
+
+private:
+    struct Entry
+    {
+        juce::String key;
+        std::shared_ptr<juce::AudioBuffer<float>> buffer;
+        juce::int64 size;
+    };
+
+    // a file that's being decoded
+    struct Decode
+    {
+        int numDecoders = 0; // the same file can be decoded for more than one Track at once
+        bool waiting = false; // whether onDecodingFinished should be called when it's done
+    };
+
+    juce::CriticalSection lock;
+    std::list<Entry> entries; // most recently used first. Only a few tracks fit in memory, so a list is enough
+    std::map<juce::String, Decode> decodes; // keyed by the file's full path
+    juce::int64 maxSize;
+    juce::int64 currentSize;
+
+    static juce::String getKey(const juce::File& file);
+
+    /**
+     *@brief Drops the least recently used entries until the cache fits in maxSize. lock must be held.
+     */
+    void removeOldEntries();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedAudioCache)
+};
@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    DecodingAudioSource.cpp
+
+  ==============================================================================
+*/
+
+#include "DecodingAudioSource.h"
+
+DecodingAudioSource::DecodingAudioSource(const juce::AudioBuffer<float>& decodedBuffer, const std::atomic<int>& decodedCount,
+                                         juce::PositionableAudioSource* fallbackSource)
+    : buffer(decodedBuffer), numSamplesDecoded(decodedCount), fallback(fallbackSource), numFallbackUsers(0), position(0),
+      numFallbackBlocks(0)
+{
+}
+
+DecodingAudioSource::~DecodingAudioSource()
+{
+    delete fallback.load();
+}
+
+void DecodingAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    numFallbackUsers++;
+    if (auto* source = fallback.load()) {
+        source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+    numFallbackUsers--;
+}
+
+void DecodingAudioSource::releaseResources()
+{
+    numFallbackUsers++;
+    if (auto* source = fallback.load()) {
+        source->releaseResources();
+    }
+    numFallbackUsers--;
+}
+
+void DecodingAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // pairs with the decoder's store, so the samples before decoded are safe to read
+    const juce::int64 decoded = numSamplesDecoded.load(std::memory_order_acquire);
+    const juce::int64 length = buffer.getNumSamples();
+    const int numSamples = bufferToFill.numSamples;
+
+    const int numFromBuffer = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, decoded - position);
+    const int numFromFallback = (int) juce::jlimit((juce::int64) 0, (juce::int64) (numSamples - numFromBuffer),
+                                                   length - position - numFromBuffer);
+
+    if (numFromBuffer > 0) {
+        const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), buffer.getNumChannels());
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample, buffer, channel, (int) position, numFromBuffer);
+        }
+        for (int channel = numChannels; channel < bufferToFill.buffer->getNumChannels(); channel++)
+        {
+            bufferToFill.buffer->clear(channel, bufferToFill.startSample, numFromBuffer);
+        }
+    }
+
+    if (numFromFallback > 0) {
+        numFallbackBlocks.store(numFallbackBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        const int start = bufferToFill.startSample + numFromBuffer;
+
+        // registering as a user before loading the pointer means releaseFallback() can't delete it until
+        // this block is done with it
+        numFallbackUsers++;
+        if (auto* source = fallback.load()) {
+            // the fallback only has to seek when playback has jumped, or first reaches the decoder
+            const juce::int64 fallbackPosition = position + numFromBuffer;
+            if (source->getNextReadPosition() != fallbackPosition) {
+                source->setNextReadPosition(fallbackPosition);
+            }
+            source->getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer, start, numFromFallback));
+        } else {
+            bufferToFill.buffer->clear(start, numFromFallback);
+        }
+        numFallbackUsers--;
+    }
+
+    // past the end of the audio
+    const int numDone = numFromBuffer + numFromFallback;
+    if (numDone < numSamples) {
+        bufferToFill.buffer->clear(bufferToFill.startSample + numDone, numSamples - numDone);
+    }
+
+    position += numSamples;
+}
+
+void DecodingAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = juce::jmax((juce::int64) 0, newPosition);
+}
+
+juce::int64 DecodingAudioSource::getNextReadPosition() const
+{
+    return position;
+}
+
+juce::int64 DecodingAudioSource::getTotalLength() const
+{
+    return buffer.getNumSamples();
+}
+
+bool DecodingAudioSource::isLooping() const
+{
+    return false;
+}
+
+int DecodingAudioSource::getNumFallbackBlocks() const
+{
+    return numFallbackBlocks.load(std::memory_order_relaxed);
+}
+
+void DecodingAudioSource::releaseFallback()
+{
+    std::unique_ptr<juce::PositionableAudioSource> source(fallback.exchange(nullptr));
+    while (numFallbackUsers.load() > 0)
+    {
+        juce::Thread::yield();
+    }
+    if (source != nullptr) {
+        source->releaseResources();
+    }
+}
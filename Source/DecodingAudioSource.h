@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    DecodingAudioSource.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// This class plays a buffer that's still being decoded on another thread. Only the samples before
+// numSamplesDecoded are read from the buffer, and its value is loaded with acquire ordering, so every
+// sample read was fully written by the decoder first. Anything past that point (e.g. after a seek
+// ahead of the decoder, or if the decoder falls behind) is played from the fallback source instead,
+// which streams it from the file. The decoder must only ever write samples at or after numSamplesDecoded,
+// and must store the new count with release ordering once they're written. Once the whole buffer has been
+// decoded, the fallback is never needed again, so the decoder can delete it with releaseFallback().
+
+class DecodingAudioSource : public juce::PositionableAudioSource
+{
+public:
+    /**
+     *@param buffer  the buffer being decoded into. Must outlive this source
+     *@param numSamplesDecoded  the number of samples at the start of buffer that have been decoded. Must outlive this source
+     *@param fallback  plays the same audio from the file, for samples that haven't been decoded yet. Owned by this source.
+     *                 If nullptr, those samples are silent
+     */
+    DecodingAudioSource(const juce::AudioBuffer<float>& buffer, const std::atomic<int>& numSamplesDecoded,
+                        juce::PositionableAudioSource* fallback);
+    ~DecodingAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    /**
+     *@brief Returns the number of blocks that needed samples the decoder hadn't reached yet.
+     */
+    int getNumFallbackBlocks() const;
+
+    /**
+     *@brief Deletes the fallback source, along with its reader and read-ahead buffer.
+     *Should only be called once the whole buffer has been decoded. Waits for the audio thread to finish
+     *with the fallback if it's using it, which is never for longer than one block.
+     */
+    void releaseFallback();
+
+private:
+    const juce::AudioBuffer<float>& buffer;
+    const std::atomic<int>& numSamplesDecoded;
+    std::atomic<juce::PositionableAudioSource*> fallback; // owned by this source, nullptr once released
+    std::atomic<int> numFallbackUsers; // the number of threads using fallback, so it's only deleted once they're done
+    juce::int64 position;
+    std::atomic<int> numFallbackBlocks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodingAudioSource)
+};
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    FFT.cpp
+
+  ==============================================================================
+*/
+
+#include "FFT.h"
+#include <cmath>
+
+FFT::FFT(int fftSize) : size(fftSize), twiddles((size_t) fftSize / 2), bitReversed((size_t) fftSize)
+{
+    for (int i = 0; i < size / 2; i++)
+    {
+        double angle = -2.0 * juce::MathConstants<double>::pi * i / size;
+        twiddles[i] = std::complex<float>((float) std::cos(angle), (float) std::sin(angle));
+    }
+
+    int numBits = 0;
+    while ((1 << numBits) < size)
+    {
+        numBits++;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < numBits; bit++)
+        {
+            reversed |= ((i >> bit) & 1) << (numBits - 1 - bit);
+        }
+        bitReversed[i] = reversed;
+    }
+}
+
+void FFT::perform(std::complex<float>* data, bool inverse) const
+{
+    for (int i = 0; i < size; i++)
+    {
+        if (i < bitReversed[i]) {
+            std::swap(data[i], data[bitReversed[i]]);
+        }
+    }
+
+    for (int length = 2; length <= size; length <<= 1)
+    {
+        const int half = length / 2;
+        const int step = size / length;
+
+        for (int start = 0; start < size; start += length)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                const std::complex<float> w = twiddles[k * step];
+                const float wImag = inverse ? -w.imag() : w.imag();
+                const std::complex<float> a = data[start + k];
+                const std::complex<float> b = data[start + k + half];
+                const std::complex<float> bw(b.real() * w.real() - b.imag() * wImag, b.real() * wImag + b.imag() * w.real());
+
+                data[start + k] = a + bw;
+                data[start + k + half] = a - bw;
+            }
+        }
+    }
+
+    if (inverse) {
+        const float scale = 1.0f / (float) size;
+        for (int i = 0; i < size; i++)
+        {
+            data[i] *= scale;
+        }
+    }
+}
+
+int FFT::getSize() const
+{
+    return size;
+}
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    FFT.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include <vector>
+
+// A radix-2 complex FFT, shared by ConvolutionReverb and TimeStretcher.
+// The twiddle factors and bit-reversed indices are worked out up front, so perform() never allocates.
+
+class FFT
+{
+public:
+    /**
+     *@param fftSize  the number of points, which must be a power of 2
+     */
+    FFT(int fftSize);
+
+    /**
+     *@brief Transforms data in place. The inverse transform is scaled by 1/size.
+     */
+    void perform(std::complex<float>* data, bool inverse) const;
+
+    int getSize() const;
+
+private:
+    int size;
+    std::vector<std::complex<float>> twiddles;
+    std::vector<int> bitReversed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FFT)
+};
@@ -8,6 +8,8 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
 
 class AbkPlayerApplication  : public juce::JUCEApplication
 {
@@ -24,6 +26,21 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // with --render, the files on the command line are rendered to disk and the app quits,
+        // without opening a window or an audio device
+        if (BatchRenderer::isRenderCommand(getCommandLineParameterArray())) {
+            setApplicationReturnValue(BatchRenderer::runFromCommandLine(getCommandLineParameterArray()));
+            quit();
+            return;
+        }
+
+        // with --bench, the DSP is checked and timed on synthetic audio, and the app quits
+        if (Benchmark::isBenchmarkCommand(getCommandLineParameterArray())) {
+            setApplicationReturnValue(Benchmark::runFromCommandLine(getCommandLineParameterArray()));
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
 
@@ -1,11 +1,11 @@
 #include "MainComponent.h"
 
-MainComponent::MainComponent() : state(NoFile), queueDisplay("Queue", &queueModel), bpmInput("bpmInput")
+MainComponent::MainComponent() : slowAmount(0.0), state(NoFile), handledTrackChanges(0), playbackEvents([this] { handlePlaybackEvents(); }), audioTrackChanges(0), audioStreamFinished(false), queueDisplay("Queue", &queueModel), bpmInput("bpmInput")
 {
     this->addKeyListener(this);
     
     // set window size
-    setSize (600, 400);
+    setSize (600, 580);
 
     // Some platforms require permissions to open input channels so request that here
     if (juce::RuntimePermissions::isRequired (juce::RuntimePermissions::recordAudio)
@@ -48,12 +48,19 @@ MainComponent::MainComponent() : state(NoFile), queueDisplay("Queue", &queueMode
     pauseButton.setColour(juce::TextButton::buttonColourId, newBlue);
     pauseButton.setEnabled(false);
     
+    addAndMakeVisible(&irButton);
+    irButton.setButtonText("Load IR...");
+    irButton.onClick = [this] { irButtonClicked(); };
+    
     addAndMakeVisible(&reverbLabel);
     reverbLabel.setText("Reverb", juce::dontSendNotification);
     reverbLabel.attachToComponent(&reverbSlider, false);
     
     addAndMakeVisible(&reverbSlider);
     reverbSlider.addListener(this);
+    // if reverbSlider is dragged to 0, make sure it registers as a change
+    // see issue #26 for details: https://github.com/andrewking1597/SlowReverbPlayer/issues/26
+    reverbSlider.onDragEnd = [this] { reverbSliderValueChanged(); };
     reverbSlider.setValue(0.0f);
     reverbSlider.setPathColor(newGreen);
     
@@ -71,16 +78,70 @@ MainComponent::MainComponent() : state(NoFile), queueDisplay("Queue", &queueMode
     bpmButton.changeWidthToFitText();
     bpmButton.onClick = [this] { bpmButtonClicked(); };
     
+    // applies to files that haven't started being analysed when it's toggled
+    addAndMakeVisible(&fastBpmButton);
+    fastBpmButton.setButtonText("Fast BPM");
+    fastBpmButton.changeWidthToFitText();
+    fastBpmButton.onClick = [this] { fastBpm.store(fastBpmButton.getToggleState()); };
+    
     addAndMakeVisible(&bpmInput);
     bpmInput.setInputFilter(new BpmInputFilter, true);
     
+    // the load mode is applied the next time a file is loaded
+    addAndMakeVisible(&loadModeBox);
+    loadModeBox.addItem("Decode to memory", Track::DecodeToMemory);
+    loadModeBox.addItem("Stream from disk", Track::StreamFromDisk);
+    loadModeBox.addItem("Memory-map file", Track::MemoryMapped);
+    loadModeBox.setSelectedId(Track::DecodeToMemory, juce::dontSendNotification);
+    
+    // the smoother qualities cost more CPU; see Resampler.h and TimeStretcher.h
+    addAndMakeVisible(&qualityBox);
+    qualityBox.addItem("Duplicate samples", SlowAudioSource::Duplicate);
+    qualityBox.addItem("Linear interpolation", SlowAudioSource::Linear);
+    qualityBox.addItem("Cubic interpolation", SlowAudioSource::CubicHermite);
+    qualityBox.addItem("Windowed sinc", SlowAudioSource::WindowedSinc);
+    qualityBox.addItem("Keep pitch", SlowAudioSource::KeepPitch);
+    qualityBox.setSelectedId(SlowAudioSource::Duplicate, juce::dontSendNotification);
+    qualityBox.onChange = [this] { qualityBoxChanged(); };
+    
+    addAndMakeVisible(&crossfadeLabel);
+    crossfadeLabel.setText("Crossfade", juce::dontSendNotification);
+    crossfadeLabel.attachToComponent(&crossfadeSlider, true);
+    
+    addAndMakeVisible(&crossfadeSlider);
+    crossfadeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    crossfadeSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 50, 20);
+    crossfadeSlider.setRange(0.0, 10.0, 0.1);
+    crossfadeSlider.setTextValueSuffix(" s");
+    crossfadeSlider.addListener(this);
+    
+    // the waveform of the current track, filled in while the track loads
+    addAndMakeVisible(&waveform);
+    
+    // shows how close the audio callbacks come to missing their deadline, and dumps it for monitoring
+    addAndMakeVisible(&callbackStatsPanel);
+    
     //==============================================================================
     
     addAndMakeVisible(&queueDisplay);
     queueDisplay.setWantsKeyboardFocus(false);
+    // detect the BPM of each file in the background as soon as it's queued. There's a fixed number of
+    // workers, which take files from the queue as they finish the last one
+    queueModel.onItemAdded = [this] (const juce::File&) { analyseQueuedFiles(); };
+    decodedCache.onDecodingFinished = [this] (const juce::File& file, std::shared_ptr<juce::AudioBuffer<float>> buffer)
+    {
+        decodingFinished(file, buffer);
+    };
+    for (int i = 0; i < juce::jmax(1, juce::SystemStats::getNumCpus() - 1); i++)
+    {
+        bpmWorkers.add(new BpmWorker(*this))->startThread();
+    }
     
     // Configure formatManager to read wav and aiff files
     formatManager.registerBasicFormats();
+    readAheadThread.startThread();
+    // the playlist is the transport's only source; tracks are swapped in and out of it
+    transport.setSource(&playlist);
     // listen for when the state of transport changes and call the changeListener callback function
     transport.addChangeListener(this);
     // call transportStateChanged to set up initial state
@@ -91,26 +152,99 @@ MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
+    transport.setSource(nullptr);
+    // wait for the prefetch job, since it calls back into this object. It may be loading either track
+    if (nextTrack != nullptr) {
+        nextTrack->cancelLoading();
+    }
+    if (currentTrack != nullptr) {
+        currentTrack->cancelLoading();
+    }
+    prefetchPool.removeAllJobs(true, 10000);
+    // BPM workers stop reading as soon as they're asked to, so it's safe to wait for them without a timeout.
+    // They use aubio, the caches and formatManager, so they must be finished before any of those go
+    for (auto* worker : bpmWorkers)
+    {
+        worker->signalThreadShouldExit();
+    }
+    for (auto* worker : bpmWorkers)
+    {
+        worker->stopThread(-1);
+    }
+    nextTrack.reset();
+    currentTrack.reset();
+    // only clean up aubio once no other thread can be using it
+    aubio_cleanup();
 }
 
 //==============================================================================
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
+    // the playlist mixes in the next track from a buffer of its own, which needs as many channels as
+    // the device's buffers have. AudioSourcePlayer gives them one per active input or output channel
+    if (auto* device = deviceManager.getCurrentAudioDevice()) {
+        playlist.setNumChannels(juce::jmax(device->getActiveOutputChannels().countNumberOfSetBits(),
+                                           device->getActiveInputChannels().countNumberOfSetBits()));
+    }
     transport.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    callbackStats.prepare(samplesPerBlockExpected, sampleRate);
     
+    juce::Reverb::Parameters params = reverbParamUpdates.get();
     reverb.setSampleRate(sampleRate);
-    reverb.setParameters(reverbParams);
+    reverb.setParameters(params);
+    convolutionReverb.setLevels(params.wetLevel, params.dryLevel);
+    convolutionReverb.setSampleRate(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
     transport.getNextAudioBlock(bufferToFill);
     
-    // get pointer to each channel of buffer
-    float* left = bufferToFill.buffer->getWritePointer(0);
-    float* right = bufferToFill.buffer->getWritePointer(1);
-    // apply reverb
-    reverb.processStereo(left, right, bufferToFill.numSamples);
+    // publish the playhead position, and flag it if the playlist moved on or the last track finished
+    // during this block. Setting the flags wakes the message thread without blocking or allocating
+    playbackEvents.setPosition(transport.getNextReadPosition());
+    
+    int trackChanges = playlist.getTrackChangeCount();
+    if (trackChanges != audioTrackChanges) {
+        audioTrackChanges = trackChanges;
+        playbackEvents.setTrackChanged();
+    }
+    
+    bool streamFinished = transport.hasStreamFinished();
+    if (streamFinished != audioStreamFinished) {
+        audioStreamFinished = streamFinished;
+        if (streamFinished) {
+            playbackEvents.setEndOfStream();
+        }
+    }
+    
+    // pick up any new reverb parameters. The reverbs smooth them over the next few milliseconds
+    juce::Reverb::Parameters params;
+    if (reverbParamUpdates.getIfChanged(params)) {
+        reverb.setParameters(params);
+        convolutionReverb.setLevels(params.wetLevel, params.dryLevel);
+    }
+    
+    // apply reverb to the first two channels, or the only one if the output is mono
+    bool useConvolution = convolutionReverb.hasImpulseResponse();
+    float* left = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
+    if (bufferToFill.buffer->getNumChannels() > 1) {
+        float* right = bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample);
+        if (useConvolution) {
+            convolutionReverb.processStereo(left, right, bufferToFill.numSamples);
+        } else {
+            reverb.processStereo(left, right, bufferToFill.numSamples);
+        }
+    } else {
+        if (useConvolution) {
+            convolutionReverb.processMono(left, bufferToFill.numSamples);
+        } else {
+            reverb.processMono(left, bufferToFill.numSamples);
+        }
+    }
+    
+    callbackStats.addCallback(startTicks);
 }
 
 void MainComponent::releaseResources()
@@ -141,33 +275,40 @@ void MainComponent::resized()
     
     bpmButton.setBounds(40, 300, 80, 30);
     bpmInput.setBounds(40+bpmButton.getWidth()+10, 300, 50, 30);
+    loadModeBox.setBounds(223, 300, 233, 30);
+    fastBpmButton.setBounds(466, 300, 100, 30);
+    crossfadeSlider.setBounds(140, 345, 316, 30);
+    irButton.setBounds(466, 345, 100, 30);
+    qualityBox.setBounds(223, 390, 233, 30);
+    waveform.setBounds(40, 435, 526, 50);
+    callbackStatsPanel.setBounds(40, 495, 526, 70);
 }
 
 //==============================================================================
 
 void MainComponent::openButtonClicked()
 {
-    // Choose a file
-    juce::FileChooser chooser("Choose a Wav file...", juce::File::getSpecialLocation(juce::File::userDesktopDirectory), "*.wav;*.aiff", true, false, nullptr);
+    // Choose one or more files
+    juce::FileChooser chooser("Choose Wav files...", juce::File::getSpecialLocation(juce::File::userDesktopDirectory), "*.wav;*.aiff", true, false, nullptr);
     
-    // If the user chooses a file
-    if (chooser.browseForFileToOpen())
+    // If the user chooses any files
+    if (chooser.browseForMultipleFilesToOpen())
     {
-        // Get the chosen file and add to queue
-        juce::File loadedFile = chooser.getResult();
-        queueModel.addItem(loadedFile);
+        // Add the chosen files to the queue, updating the list once for all of them
+        bool wasEmpty = queueModel.getNumRows() == 0;
+        queueModel.addItems(chooser.getResults());
         queueDisplay.updateContent();
         
-        // if this is the only file in the queue, set reader
-        if (queueModel.getNumRows() == 1)
+        // if the queue was empty, set reader
+        if (wasEmpty && queueModel.getNumRows() > 0)
         {
-            reader.reset(formatManager.createReaderFor(loadedFile));
-            // allocate space in originalBuffer
-            originalBuffer.setSize(2, (int) reader->lengthInSamples, false, true, false);
-            reader->read(originalBuffer.getArrayOfWritePointers(), originalBuffer.getNumChannels(), 0, (int) reader->lengthInSamples);
+            loadAudio(queueModel.getHead());
             prepareAudio();
             transportStateChanged(Stopped);
         }
+        
+        // if this is the second file in the queue, start loading it in the background
+        prefetchNextTrack();
     }
 }
 
@@ -183,6 +324,9 @@ void MainComponent::stopButtonClicked()
 
 void MainComponent::transportStateChanged(TransportState newState)
 {
+    // make sure the queue has caught up with the playlist before it's changed
+    handleTrackChanges();
+    
     TransportState oldState = state;
     state = newState;
     
@@ -195,26 +339,24 @@ void MainComponent::transportStateChanged(TransportState newState)
             reverbSlider.setValue(0.0);
             slowSlider.setValue(0.0);
             transport.setPosition(0.0);
+            waveform.setFile(juce::File());
             break;
         case Done:
-            stopTimer();
             isPaused = false;
             transport.stop();
             queueModel.popHead();
             queueDisplay.updateContent();
             if (queueModel.getNumRows() > 0) {
-                reader.reset(formatManager.createReaderFor(queueModel.getHead()));
-                originalBuffer.setSize(2, (int) reader->lengthInSamples, false, true, false);
-                reader->read(originalBuffer.getArrayOfWritePointers(), originalBuffer.getNumChannels(), 0, (int) reader->lengthInSamples);
+                loadAudio(queueModel.getHead());
                 transport.setPosition(0.0);
                 prepareAudio();
                 transportStateChanged(oldState);
             } else {
+                discardNextTrack();
                 transportStateChanged(NoFile);
             }
             break;
         case Stopped:
-            stopTimer();
             isPaused = false;
             transport.stop();
             transport.setPosition(0.0);
@@ -228,10 +370,8 @@ void MainComponent::transportStateChanged(TransportState newState)
             stopButton.setEnabled(true);
             pauseButton.setEnabled(true);
             transport.start();
-            startTimer(10);
             break;
         case Paused:
-            stopTimer();
             isPaused = true;
             transport.stop();
             pauseButton.setEnabled(false);
@@ -246,157 +386,355 @@ void MainComponent::pauseButtonClicked()
     transportStateChanged(Paused);
 }
 
-void MainComponent::prepareAudio()
+void MainComponent::irButtonClicked()
 {
-    if (bpmButton.getToggleState()) {
-        updateSlowSliderViaBpm();
+    if (convolutionReverb.hasImpulseResponse()) {
+        convolutionReverb.clearImpulseResponse();
+        irButton.setButtonText("Load IR...");
         return;
     }
     
-    int newInterval = 100 / slowSlider.getValue();
+    juce::FileChooser chooser("Choose an impulse response...", juce::File::getSpecialLocation(juce::File::userDesktopDirectory), "*.wav;*.aiff", true, false, nullptr);
     
-    // if slider set to 0: set interval to be greater than numSamples so audio won't be slowed at all
-    if (slowSlider.getValue() == 0) {
-        newInterval = (float)originalBuffer.getNumSamples()+1;
+    if (chooser.browseForFileToOpen() && convolutionReverb.loadImpulseResponse(chooser.getResult(), formatManager)) {
+        irButton.setButtonText("Clear IR");
     }
-    
-    slowInterval = newInterval;
-    slowAudio(slowInterval);
 }
 
-void MainComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
+void MainComponent::qualityBoxChanged()
 {
+    int quality = qualityBox.getSelectedId();
+    
+    if (currentTrack != nullptr && currentTrack->isLoaded()) {
+        currentTrack->getSlowSource()->setQuality(quality);
+    }
+    if (nextTrack != nullptr && nextTrack->isLoaded()) {
+        nextTrack->getSlowSource()->setQuality(quality);
+    }
 }
 
-int MainComponent::getDestIndex(int sourceSampleNum, int interval)
+void MainComponent::loadAudio(juce::File file)
 {
-    int samplesToDuplicate, destIndex;
-    
-    if (sourceSampleNum % interval == 0) {
-        samplesToDuplicate = sourceSampleNum / interval;
+    // use the prefetched track if it's the right file, even if it's still loading, otherwise load the file now
+    std::shared_ptr<Track> track;
+    if (nextTrack != nullptr && nextTrack->getFile() == file && (!nextTrack->hasFinishedLoading() || nextTrack->isLoaded())) {
+        track = nextTrack;
+        nextTrack.reset();
     } else {
-        samplesToDuplicate = (sourceSampleNum/interval) + 1;
+        track = std::make_shared<Track>(file);
+        track->load(formatManager, loadModeBox.getSelectedId(), readAheadThread, &decodedCache);
     }
     
-    destIndex = samplesToDuplicate * 2 + sourceSampleNum - samplesToDuplicate;
+    // the BPM may have already been detected in the background
+    if (!track->hasBpm() && queueModel.getNumRows() > 0 && queueModel.getHead() == file) {
+        track->setBpm(queueModel.getBpm(0));
+    }
+    
+    // swap the playlist over to the new track before the previous one is deleted
+    std::shared_ptr<Track> previousTrack = currentTrack;
+    currentTrack = track;
+    playCurrentTrack();
+    previousTrack.reset();
+    waveform.setFile(file);
+    
+    // skip the file once whatever called this has finished with it, so a run of unreadable files
+    // doesn't recurse through transportStateChanged()
+    if (track->hasFailedToLoad()) {
+        juce::Component::SafePointer<MainComponent> safeThis(this);
+        juce::MessageManager::callAsync([safeThis, track]
+        {
+            if (safeThis != nullptr) {
+                safeThis->skipUnplayableTrack(track);
+            }
+        });
+    }
     
-    return destIndex;
+    // start loading the file after this one
+    prefetchNextTrack();
 }
 
-void MainComponent::sliderValueChanged(juce::Slider* slider)
+void MainComponent::playCurrentTrack()
 {
-    if (slider == &reverbSlider) {
-        reverbSliderValueChanged();
-    } else if (slider == &slowSlider) {
-        slowSliderValueChanged();
-    }
+    bool ready = currentTrack != nullptr && currentTrack->isLoaded();
     
-    return;
+    if (ready) {
+        currentTrack->getSlowSource()->setQuality(qualityBox.getSelectedId());
+        currentTrack->getSlowSource()->setSlowAmount(slowAmount);
+    }
+    playlist.setCurrentSource(ready ? currentTrack->getSlowSource() : nullptr);
 }
 
-void MainComponent::reverbSliderValueChanged()
+void MainComponent::skipUnplayableTrack(std::shared_ptr<Track> track)
 {
-    // convert reverb value to the range 0-1
-    float val = (float)reverbSlider.getValue() / 100;
-    
-    // Use val to set wet and dry levels
-    reverbParams.wetLevel = val;
-    reverbParams.dryLevel = 1.0f - val;
+    if (track != currentTrack) {
+        return;
+    }
     
-    reverb.setParameters(reverbParams);
+    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Couldn't play file",
+                                           track->getFile().getFullPathName() + " couldn't be read, so it has been skipped.");
     
-    return;
+    // moves on to the next file in the queue, carrying on playing if it was
+    transportStateChanged(Done);
 }
 
-void MainComponent::slowSliderValueChanged()
+void MainComponent::prefetchNextTrack()
 {
-    // if no file is loaded, set slider back to 0
-    if (state == NoFile) {
-        slowSlider.setValue(0);
+    if (queueModel.getNumRows() < 2) {
+        discardNextTrack();
         return;
     }
     
-    // Keep track of whether audio was playing or not
-    // (we'll resume playback if it was playing)
-    TransportState oldState = state;
+    juce::File nextFile = queueModel.getItem(1);
     
-    // Temporarily pause audio playback
-    transportStateChanged(Paused);
+    // if that file is already being loaded, just make sure the playlist will play it
+    if (nextTrack != nullptr && nextTrack->getFile() == nextFile) {
+        chainNextTrack();
+        return;
+    }
     
-    double currPosition = transport.getCurrentPosition(); // get playhead position (in seconds)
-    double positionRatio = currPosition / transport.getLengthInSeconds();
+    discardNextTrack();
     
-    // if slider set to 0: set interval to be greater than numSamples so audio won't be slowed at all
-    int newInterval;
-    if (slowSlider.getValue() > 0) {
-        newInterval = 100 / slowSlider.getValue();
-    } else {
-        newInterval = originalBuffer.getNumSamples() + 1;
+    std::shared_ptr<Track> track = std::make_shared<Track>(nextFile);
+    int loadMode = loadModeBox.getSelectedId();
+    // if the BPM hasn't been detected yet, bpmDetected() passes it on when it is
+    track->setBpm(queueModel.getBpm(1));
+    nextTrack = track;
+    
+    // the job keeps its own reference to track, so it's safe for nextTrack to be discarded while it runs
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    prefetchPool.addJob([this, safeThis, track, loadMode]
+    {
+        track->load(formatManager, loadMode, readAheadThread, &decodedCache);
+        
+        // hand the track to the playlist on the message thread, if it's still the next one,
+        // or if loadAudio() made it the current track before it had finished loading
+        juce::MessageManager::callAsync([safeThis, track]
+        {
+            if (safeThis == nullptr) {
+                return;
+            }
+            if (safeThis->nextTrack == track) {
+                safeThis->chainNextTrack();
+            } else if (safeThis->currentTrack == track && track->hasFailedToLoad()) {
+                // the playlist has been playing silence while it waited, and would carry on forever
+                safeThis->skipUnplayableTrack(track);
+            } else if (safeThis->currentTrack == track && safeThis->playlist.getCurrentSource() == nullptr) {
+                // setting the current source clears the next one, so it's chained again
+                safeThis->playCurrentTrack();
+                safeThis->chainNextTrack();
+            }
+        });
+    });
+}
+
+void MainComponent::discardNextTrack()
+{
+    if (nextTrack == nullptr) {
+        return;
     }
     
-    // Slow the audio
-    slowInterval = newInterval;
-    slowAudio(slowInterval);
+    // once the playlist has let go of the track it can't start playing it,
+    // but it may have already moved on to it
+    playlist.setNextSource(nullptr);
+    handleTrackChanges();
     
-    // Adjust playhead position to account for the duplicated samples
-    double newPosition = positionRatio * transport.getLengthInSeconds();
-    transport.setPosition(newPosition);
+    if (nextTrack != nullptr) {
+        nextTrack->cancelLoading();
+        nextTrack.reset();
+    }
+}
+
+void MainComponent::chainNextTrack()
+{
+    handleTrackChanges();
     
-    // Revert to the previous state
-    transportStateChanged(oldState);
-    // If paused, adjust playhead to account for the duplicated samples
-    if (state == Paused) {
-        transport.setPosition(newPosition);
+    if (nextTrack == nullptr || !nextTrack->isLoaded()) {
+        return;
     }
+    
+    nextTrack->getSlowSource()->setQuality(qualityBox.getSelectedId());
+    nextTrack->getSlowSource()->setSlowAmount(getTrackSlowAmount(*nextTrack));
+    playlist.setNextSource(nextTrack->getSlowSource());
 }
 
-void MainComponent::slowAudio(int interval)
+void MainComponent::handleTrackChanges()
 {
-    // set slowBuffer's size to hold enough samples for the slowed audio
-    slowBuffer.setSize(2, 1 + (int)reader->lengthInSamples + (int)reader->lengthInSamples / interval, false, true, false);
-    slowBuffer.clear(); //todo unnecessary bc clearExtraSpace is set to true in the setSize call =============A
+    while (handledTrackChanges < playlist.getTrackChangeCount())
+    {
+        handledTrackChanges++;
+        
+        // the finished track can be deleted now that the playlist has moved past it
+        queueModel.popHead();
+        queueDisplay.updateContent();
+        currentTrack = nextTrack;
+        nextTrack.reset();
+        waveform.setFile(currentTrack != nullptr ? currentTrack->getFile() : juce::File());
+        
+        prepareAudio();
+        prefetchNextTrack();
+    }
+}
+
+double MainComponent::getTrackSlowAmount(Track& track)
+{
+    // with "Use BPM" toggled, each track is matched to the target BPM
+    if (bpmButton.getToggleState() && track.hasBpm()) {
+        return 100 * (track.getBpm() - getTargetBpm()) / track.getBpm();
+    }
     
-    // copy each sample from tempBuffer to slowBuffer and duplicate every interval-th sample
-    for (int sourceSampleIX = 0; sourceSampleIX < originalBuffer.getNumSamples(); sourceSampleIX++)
+    return slowAmount;
+}
+
+void MainComponent::analyseQueuedFiles()
+{
+    // a worker that's busy will take the next file itself when it finishes
+    for (auto* worker : bpmWorkers)
     {
-        // calculate the index to write the sample and write the sample for each channel
-        int destSampleIX = getDestIndex(sourceSampleIX, interval);
-        slowBuffer.setSample(0, destSampleIX, originalBuffer.getSample(0, sourceSampleIX)); // channel 0
-        slowBuffer.setSample(1, destSampleIX, originalBuffer.getSample(1, sourceSampleIX)); // channel 1
+        worker->notify();
+    }
+}
 
-        // if sourceSampleIX is a multiple of the interval: copy the samples to the next index also
-        if (sourceSampleIX % interval == 0)
-        {
-            slowBuffer.setSample(0, destSampleIX+1, originalBuffer.getSample(0, sourceSampleIX)); // channel 0
-            slowBuffer.setSample(1, destSampleIX+1, originalBuffer.getSample(1, sourceSampleIX)); // channel 1
+void MainComponent::decodingFinished(const juce::File& file, std::shared_ptr<juce::AudioBuffer<float>> buffer)
+{
+    if (buffer != nullptr) {
+        const juce::ScopedLock sl(decodedForBpmLock);
+        decodedForBpm[file.getFullPathName()] = buffer;
+    }
+    queueModel.analyseFileNext(file);
+    analyseQueuedFiles();
+}
+
+MainComponent::BpmWorker::BpmWorker(MainComponent& ownerComponent)
+    : juce::Thread("BPM detection"), owner(ownerComponent), safeOwner(&ownerComponent)
+{
+}
+
+void MainComponent::BpmWorker::run()
+{
+    // owner can't be deleted while this runs, since its destructor stops the workers first
+    while (!threadShouldExit())
+    {
+        juce::File file;
+        if (!owner.queueModel.takeFileToAnalyse(file)) {
+            // notify() is sticky, so a file queued since the check above still wakes this straight away
+            wait(-1);
+            continue;
+        }
+        
+        float agreement;
+        float bpm = owner.getFileBpm(&file, owner.fastBpm.load(), agreement, this);
+        
+        if (!threadShouldExit()) {
+            juce::Component::SafePointer<MainComponent> safeThis = safeOwner;
+            juce::MessageManager::callAsync([safeThis, file, bpm, agreement]
+            {
+                if (safeThis != nullptr) {
+                    safeThis->bpmDetected(file, bpm, agreement);
+                }
+            });
         }
     }
+}
+
+void MainComponent::bpmDetected(juce::File file, float bpm, float agreement)
+{
+    if (bpm <= 0) {
+        return;
+    }
     
-    if (reader != nullptr) {
-        // Pass the data to playSource
-        std::unique_ptr<juce::MemoryAudioSource> tempSource(new juce::MemoryAudioSource(slowBuffer, false));
-        transport.setSource(tempSource.get()); // set transport source to the data that tempSource is pointing to
-        transportStateChanged(Stopped);
-        playSource.reset(tempSource.release());
+    queueModel.setBpm(file, bpm, agreement);
+    queueDisplay.repaint();
+    
+    if (currentTrack != nullptr && currentTrack->getFile() == file && !currentTrack->hasBpm()) {
+        currentTrack->setBpm(bpm);
+        if (bpmButton.getToggleState()) {
+            updateSlowSliderViaBpm();
+        }
+    }
+    if (nextTrack != nullptr && nextTrack->getFile() == file && !nextTrack->hasBpm()) {
+        nextTrack->setBpm(bpm);
+        // passes the new slow amount on to nextTrack
+        chainNextTrack();
+    }
+}
+
+void MainComponent::prepareAudio()
+{
+    if (bpmButton.getToggleState()) {
+        updateSlowSliderViaBpm();
+        return;
+    }
+    
+    setSlowAmount(slowSlider.getValue());
+}
+
+void MainComponent::setSlowAmount(double newAmount)
+{
+    slowAmount = newAmount;
+    
+    if (currentTrack != nullptr && currentTrack->isLoaded()) {
+        currentTrack->getSlowSource()->setSlowAmount(slowAmount);
+    }
+}
+
+void MainComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
+{
+}
+
+void MainComponent::sliderValueChanged(juce::Slider* slider)
+{
+    if (slider == &reverbSlider) {
+        reverbSliderValueChanged();
+    } else if (slider == &slowSlider) {
+        slowSliderValueChanged();
+    } else if (slider == &crossfadeSlider) {
+        playlist.setCrossfadeLength(crossfadeSlider.getValue());
     }
     
     return;
 }
 
-void MainComponent::timerCallback()
+void MainComponent::reverbSliderValueChanged()
 {
-    // if stream is finished: change transportState
-    if (transport.getCurrentPosition() >= transport.getLengthInSeconds() && transport.getCurrentPosition() > 0)
-    {
-        transportStateChanged(Done);
+    // convert reverb value to the range 0-1
+    float val = (float)reverbSlider.getValue() / 100;
+    
+    // Use val to set wet and dry levels
+    reverbParams.wetLevel = val;
+    reverbParams.dryLevel = 1.0f - val;
+    
+    // the audio thread applies them, so they're never changed while it's using them. Every change is
+    // picked up by its next block, including a change to 0, so nothing needs to send them again on a
+    // timer the way the issue #26 workaround did
+    reverbParamUpdates.set(reverbParams);
+    
+    return;
+}
+
+void MainComponent::slowSliderValueChanged()
+{
+    // if no file is loaded, set slider back to 0
+    if (state == NoFile) {
+        slowSlider.setValue(0);
+        return;
     }
     
-    // if reverbSlider is set to 0, make sure it registers as a change
-    // see issue #26 for details: https://github.com/andrewking1597/SlowReverbPlayer/issues/26
-    if (reverbSlider.getValue() == 0 && reverbParams.wetLevel != 0) {
-        reverbSliderValueChanged();
+    // the track's SlowAudioSource keeps its place in the original audio, so the playhead doesn't
+    // need to be adjusted and playback doesn't need to be paused
+    setSlowAmount(slowSlider.getValue());
+}
+
+void MainComponent::handlePlaybackEvents()
+{
+    if (playbackEvents.takeTrackChanged()) {
+        handleTrackChanges();
     }
     
+    // the flag may be left over from a track that has since been replaced, so the transport is checked too
+    if (playbackEvents.takeEndOfStream() && state == Playing && transport.hasStreamFinished()) {
+        // the stream finished: change transportState
+        transportStateChanged(Done);
+    }
 }
 
 bool MainComponent::keyPressed(const juce::KeyPress &key, juce::Component* originatingComponent)
@@ -404,6 +742,9 @@ bool MainComponent::keyPressed(const juce::KeyPress &key, juce::Component* origi
     // note: delete key has keycode 127, x has keycode 88
     if (key.isKeyCode(88) || key.isKeyCode(127) || key.isKeyCode(8))
     {
+        // make sure the rows match the tracks being played
+        handleTrackChanges();
+        
         // get index of selected file (queueDisplay)
         int selectedRow = queueDisplay.getSelectedRow();
         std::cout << selectedRow << std::endl;
@@ -415,6 +756,8 @@ bool MainComponent::keyPressed(const juce::KeyPress &key, juce::Component* origi
             queueModel.deleteRow(selectedRow);
             // update queueDisplay
             queueDisplay.updateContent();
+            // the second file in the queue may have changed
+            prefetchNextTrack();
         }
     }
     
@@ -431,8 +774,20 @@ void MainComponent::bpmButtonClicked()
 
 void MainComponent::updateSlowSliderViaBpm()
 {
-    // detect bpm of current file
-    float sourceBpm = getFileBpm(queueModel.getHeadPtr());
+    // nothing to match if there's no file loaded
+    if (state == NoFile) {
+        return;
+    }
+    
+    // the bpm is detected in the background when the file is queued. If it isn't ready yet,
+    // bpmDetected() calls this again once it is
+    if (!currentTrack->hasBpm()) {
+        currentTrack->setBpm(queueModel.getBpm(0));
+    }
+    if (!currentTrack->hasBpm()) {
+        return;
+    }
+    float sourceBpm = currentTrack->getBpm();
     
     // calculate the value slowSlider should be set to to reach the target bpm
     float bpmSlowVal = 100 * (sourceBpm - getTargetBpm()) / sourceBpm;
@@ -443,62 +798,68 @@ void MainComponent::updateSlowSliderViaBpm()
     return;
 }
 
-float MainComponent::getFileBpm(juce::File* f)
-{
-    uint_t xsampleRate = 0; // we'll set this later
-    uint_t xwindowSize = 1024;
-    uint_t xhopSize = xwindowSize / 4;
-    uint_t xnumFrames = 0;
-    uint_t xread = 0;
-    
-    std::vector<float> bpmGuesses;
-    std::vector<float> bpmConfidences;
-    
-    juce::String pathname = f->getFullPathName(); //conversion helper
-    std::string stdpathname = pathname.toStdString(); //conversion helper
-    const char_t* xsourcePath = stdpathname.c_str();
-    aubio_source_t* xsource = new_aubio_source(xsourcePath, xsampleRate, xhopSize);
-    
-    if (xsampleRate == 0) xsampleRate = aubio_source_get_samplerate(xsource);
-    
-    // create some vectors
-    fvec_t* xin = new_fvec(xhopSize); // input audio buffer
-    fvec_t* xout = new_fvec(1); // output position
-    
-    // create tempo object
-    aubio_tempo_t* xtempoObj = new_aubio_tempo("default", xwindowSize, xhopSize, xsampleRate);
-    
-    do {
-        // put some fresh data in input vector
-        aubio_source_do(xsource, xin, &xread);
-        // execute tempo
-        aubio_tempo_do(xtempoObj, xin, xout);
-        // append to bpmGuesses and bpmConfidences
-        bpmGuesses.push_back(aubio_tempo_get_bpm(xtempoObj));
-        bpmConfidences.push_back(aubio_tempo_get_confidence(xtempoObj));
-        xnumFrames += xread;
-    } while (xread == xhopSize);
-    
-    // find the index of the highest confidence
-    float maxConf = -1;
-    float maxConf_ix = 0;
-    for (int i = 0; i < bpmConfidences.size(); i++) {
-        if (bpmConfidences.at(i) > maxConf) {
-            maxConf = bpmConfidences.at(i);
-            maxConf_ix = i;
+float MainComponent::getFileBpm(juce::File* f, bool fast, float& agreement, juce::Thread* worker)
+{
+    agreement = 0.0f;
+    
+    // if the file has already been decoded for playback, there's no need to decode it again
+    std::shared_ptr<juce::AudioBuffer<float>> decoded;
+    {
+        const juce::ScopedLock sl(decodedForBpmLock);
+        auto it = decodedForBpm.find(f->getFullPathName());
+        if (it != decodedForBpm.end()) {
+            decoded = it->second;
+            decodedForBpm.erase(it);
         }
     }
-    // get bpm at maxConf_ix of bpmGuesses
-    float bestGuess = bpmGuesses.at(maxConf_ix);
     
-    // clean up memory
-    del_aubio_tempo(xtempoObj);
-    del_fvec(xin);
-    del_fvec(xout);
-    del_aubio_source(xsource);
-    aubio_cleanup();
+    // skip aubio entirely if this file has been analysed before
+    float cachedBpm, cachedConfidence;
+    if (bpmCache.lookup(*f, cachedBpm, cachedConfidence, agreement)) {
+        return cachedBpm;
+    }
+    
+    // files are analysed in the background as soon as they're queued, so one that can't be read mustn't crash
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(*f));
+    if (reader == nullptr) {
+        return 0;
+    }
+    
+    if (decoded == nullptr) {
+        decoded = decodedCache.get(*f);
+    }
+    
+    // if it's being decoded now, it's analysed from the decoded audio once decodingFinished() hands it back
+    if (decoded == nullptr && decodedCache.waitForDecoding(*f)) {
+        return 0;
+    }
+    
+    BpmDetector::ReadFunction read = [&reader, &decoded, worker] (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples)
+    {
+        // stop between chunks if the app is quitting
+        if (worker != nullptr && worker->threadShouldExit()) {
+            return false;
+        }
+        
+        if (decoded != nullptr) {
+            for (int channel = 0; channel < dest.getNumChannels(); channel++) {
+                dest.copyFrom(channel, 0, *decoded, channel, (int) startSample, numSamples);
+            }
+        } else {
+            reader->read(&dest, 0, numSamples, startSample, true, true);
+        }
+        return true;
+    };
+    int numChannels = decoded != nullptr ? decoded->getNumChannels() : (int) reader->numChannels;
+    
+    float confidence;
+    float bpm = BpmDetector::detectStreamed(read, numChannels, reader->lengthInSamples, reader->sampleRate, fast, confidence, agreement);
+    
+    if (bpm > 0) {
+        bpmCache.store(*f, bpm, confidence, agreement);
+    }
     
-    return bestGuess;
+    return bpm;
 }
 
 float MainComponent::getTargetBpm()
@@ -8,15 +8,25 @@
 #include <iostream>
 #include <cstring>
 #include <vector>
-//#include <aubio/aubio.h>
-#include <Headers/aubio.h>
+#include <map>
 #include "CustomLookAndFeel.h"
 #include "RotarySlider.h"
 #include "NameLabel.h"
 #include "QueueModel.h"
 #include "BpmInputFilter.h"
+#include "Track.h"
+#include "PlaylistSource.h"
+#include "PlaybackEvents.h"
+#include "BpmCache.h"
+#include "BpmDetector.h"
+#include "ConvolutionReverb.h"
+#include "SimdReverb.h"
+#include "ReverbParameterUpdates.h"
+#include "CallbackStats.h"
+#include "CallbackStatsPanel.h"
+#include "WaveformOverview.h"
 
-class MainComponent  : public juce::AudioAppComponent, public juce::ChangeListener, juce::Slider::Listener, public juce::Timer, public juce::KeyListener
+class MainComponent  : public juce::AudioAppComponent, public juce::ChangeListener, juce::Slider::Listener, public juce::KeyListener
 {
 public:
     //==============================================================================
@@ -32,16 +42,30 @@ public:
     void paint (juce::Graphics& g) override;
     void resized() override;
     
-    void timerCallback() override;
-    
     bool keyPressed(const juce::KeyPress &key, juce::Component* originatingComponent) override;
 
 private:
+    // detects the BPM of queued files, taking them from queueModel one at a time and sleeping while there
+    // are none left. It stops reading a file as soon as it's asked to exit, so it can always be stopped
+    // without a timeout
+    class BpmWorker : public juce::Thread
+    {
+    public:
+        BpmWorker(MainComponent& owner);
+        void run() override;
+        
+    private:
+        MainComponent& owner;
+        juce::Component::SafePointer<MainComponent> safeOwner; // taken on the message thread, for passing the results back
+    };
+    
     CustomLookAndFeel customLookAndFeel;
-    juce::Reverb::Parameters reverbParams{0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f};
-    juce::Reverb reverb;
+    juce::Reverb::Parameters reverbParams{0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f}; // only used on the message thread
+    ReverbParameterUpdates reverbParamUpdates{reverbParams}; // passes reverbParams to the audio thread
+    SimdReverb reverb; // same sound as juce::Reverb, with the comb filters run in SIMD lanes
+    ConvolutionReverb convolutionReverb; // used instead of reverb once an impulse response has been loaded
     bool isPaused;
-    int slowInterval;
+    double slowAmount; // the percentage the current track is slowed by
     
     enum TransportState
     {
@@ -54,11 +78,23 @@ private:
     
     TransportState state; // Keeps track of the state of audio playback
     juce::AudioFormatManager formatManager; // Controls what audio formats are allowed (.wav and .aiff)
-    std::unique_ptr<juce::MemoryAudioSource> playSource; // plays data received from tempSource
+    BpmCache bpmCache{BpmCache::getDefaultCacheFile()}; // BPMs that have already been detected, so files aren't run through aubio again
+    juce::OwnedArray<BpmWorker> bpmWorkers; // detect the BPM of every file added to the queue, one file per worker at a time
+    std::atomic<bool> fastBpm{false}; // fastBpmButton's state, for the workers to read
+    DecodedAudioCache decodedCache{(juce::int64) 1024 * 1024 * 1024}; // keeps up to 1 GB of decoded files, so queueing a file again doesn't decode it again
+    juce::CriticalSection decodedForBpmLock;
+    std::map<juce::String, std::shared_ptr<juce::AudioBuffer<float>>> decodedForBpm; // files decoded for playback that are waiting for BPM detection, keyed by path
+    juce::TimeSliceThread readAheadThread{"Audio Read-Ahead"}; // reads ahead from the file when streaming from disk
+    juce::ThreadPool prefetchPool{1}; // loads the next track in the queue while the current one plays
+    std::shared_ptr<Track> currentTrack; // the track at the head of the queue
+    std::shared_ptr<Track> nextTrack; // the second track in the queue, loaded in the background
+    PlaylistSource playlist; // plays currentTrack, then moves straight on to nextTrack
+    int handledTrackChanges; // number of times the playlist has moved on that the queue has caught up with
+    PlaybackEvents playbackEvents; // passes the playhead position, track changes and the end of the stream from the audio thread to the message thread
+    int audioTrackChanges; // the playlist's track change count, as last seen by the audio thread
+    bool audioStreamFinished; // whether the transport had finished, as last seen by the audio thread
     juce::AudioTransportSource transport; // positionable audio playback object
-    std::unique_ptr<juce::AudioFormatReader> reader;
-    juce::AudioBuffer<float> slowBuffer; // will hold slowed audio data
-    juce::AudioBuffer<float> originalBuffer; // will hold audio as it is read from file
+    CallbackStats callbackStats; // how long each audio callback takes compared with its deadline
     
     QueueModel queueModel;
     juce::ListBox queueDisplay;
@@ -75,13 +111,29 @@ private:
     juce::TextButton setButton;
     NameLabel titleLabel;
     juce::ToggleButton bpmButton;
+    juce::ToggleButton fastBpmButton; // if toggled, long files are analysed from a few segments instead of all the way through
     juce::TextEditor bpmInput;
+    juce::ComboBox loadModeBox;
+    juce::ComboBox qualityBox; // how the tracks are slowed, one of the SlowAudioSource::Quality values
+    NameLabel crossfadeLabel;
+    juce::Slider crossfadeSlider;
+    juce::TextButton irButton;
+    WaveformOverview waveform{formatManager, decodedCache, [this]
+    {
+        juce::int64 length = playlist.getTotalLength();
+        return length > 0 ? (double) playbackEvents.getPosition() / (double) length : 0.0;
+    }};
+    CallbackStatsPanel callbackStatsPanel{callbackStats, [this]
+    {
+        auto* device = deviceManager.getCurrentAudioDevice();
+        return device != nullptr ? device->getXRunCount() : -1;
+    }, &convolutionReverb};
     
     //==============================================================================
     /**
      *@brief Called when openButton is clicked.
      *Opens a fileChooser window and allows user to select a file to load into the queue. If the queue was previously
-     *empty, the audio data from the selected file is read into originalBuffer and readied for playback.
+     *empty, the selected file is loaded and readied for playback.
      */
     void openButtonClicked();
     
@@ -103,6 +155,19 @@ private:
      */
     void pauseButtonClicked();
     
+    /**
+     *@brief Called when irButton is clicked.
+     *If no impulse response is loaded, opens a fileChooser window to choose one, and switches the reverb
+     *over to convolutionReverb. Otherwise the impulse response is cleared and reverb is used again.
+     */
+    void irButtonClicked();
+    
+    /**
+     *@brief Called when a different quality is chosen in qualityBox.
+     *Passes it on to the current and next tracks, which switch over without interrupting playback.
+     */
+    void qualityBoxChanged();
+    
     /**
      *@brief Changes the value of state to a TransportState value.
      *@param newState  the TransportState value to set state to
@@ -110,12 +175,91 @@ private:
     void transportStateChanged(TransportState newState);
     
     /**
-     *@brief Calculates the destination index based on the source index and interval of duplicated samples.
-     *@param sourceSampleNum  the index of the sample in the source buffer
-     *@param interval   the interval between samples to be duplicated. If every 5th sample will be duplicated, interval should be set to 5.
-     *@return  the index of the destination buffer the sample should be copied to
+     *@brief Makes a file the current track and sets it as the transport's source.
+     *If the file is being loaded by prefetchNextTrack(), the prefetched track is used, and handed to the
+     *playlist once it has loaded, so the message thread never waits for it. Otherwise the file is loaded
+     *now using the mode selected in loadModeBox. If the file can't be loaded, it's skipped.
+     *@param file  the file to load
+     *@see Track::load()
+     */
+    void loadAudio(juce::File file);
+    
+    /**
+     *@brief Hands currentTrack to the playlist if it has loaded. Until then, the playlist plays silence.
+     */
+    void playCurrentTrack();
+    
+    /**
+     *@brief Skips a track that couldn't be loaded, telling the user which file it was.
+     *The track is popped from the queue like one that has finished, and the next file is loaded in its place.
+     *Does nothing if the track is no longer the current track.
+     *@param track  the track that failed to load
+     */
+    void skipUnplayableTrack(std::shared_ptr<Track> track);
+    
+    /**
+     *@brief Starts loading the second file in the queue on prefetchPool.
+     *Does nothing if that file is already being loaded.
+     */
+    void prefetchNextTrack();
+    
+    /**
+     *@brief Cancels and deletes nextTrack.
      */
-    int getDestIndex(int sourceSampleNum, int interval);
+    void discardNextTrack();
+    
+    /**
+     *@brief Gives nextTrack to the playlist, so it plays as soon as the current track ends.
+     *Does nothing if nextTrack hasn't finished loading yet.
+     */
+    void chainNextTrack();
+    
+    /**
+     *@brief Updates the queue after the playlist has moved on to the next track by itself.
+     *Pops the head of the queue, makes nextTrack the current track and starts prefetching the track after it.
+     */
+    void handleTrackChanges();
+    
+    /**
+     *@brief Catches up with what the audio thread has done: track changes, and the end of the stream.
+     *Called by playbackEvents on the message thread as soon as the audio thread sets an event.
+     */
+    void handlePlaybackEvents();
+    
+    /**
+     *@brief Calculates the percentage a track should be slowed by.
+     *If "Use BPM" is toggled and the track's BPM is known, the amount matches the track to the target BPM.
+     *Otherwise it's the same as slowAmount.
+     *@param track  the track to calculate the amount for
+     *@return  the percentage to slow the track by
+     */
+    double getTrackSlowAmount(Track& track);
+    
+    /**
+     *@brief Wakes any bpmWorkers that are waiting for files to analyse.
+     *Called for each file added to the queue, so that its BPM is ready by the time it's played.
+     *@see bpmDetected()
+     */
+    void analyseQueuedFiles();
+    
+    /**
+     *@brief Called by decodedCache once a file that a BpmWorker was waiting for has been decoded for playback.
+     *Puts the file back at the front of the files to analyse, along with its audio, so it's analysed
+     *without being decoded a second time. Called on the thread that finished decoding.
+     *@param file  the file that was decoded
+     *@param buffer  the decoded audio, or nullptr if decoding was cancelled and the file must be read after all
+     */
+    void decodingFinished(const juce::File& file, std::shared_ptr<juce::AudioBuffer<float>> buffer);
+    
+    /**
+     *@brief Called on the message thread when a BpmWorker has detected the BPM of a file.
+     *Attaches the BPM to the file's queue entries and any track loaded from the file, and re-matches
+     *those tracks to the target BPM if "Use BPM" is toggled.
+     *@param file  the file that was analysed
+     *@param bpm  the detected BPM
+     *@param agreement  the fraction of sampled segments that agreed with the BPM, or 0 if the whole file was analysed
+     */
+    void bpmDetected(juce::File file, float bpm, float agreement);
     
     /**
      *@brief Called when a slider is moved.
@@ -128,27 +272,27 @@ private:
     
     /**
      *@brief Updates the reverb parameters to reflect the new slider value
+     *The new parameters are published through reverbParamUpdates and picked up by the audio thread on its next block.
      */
     void reverbSliderValueChanged();
     
     /**
-     *@brief Prepares the audio to be slowed and calls slowAudio()
-     *@see slowAudio()
+     *@brief Updates the slow amount of the current track to reflect the new slider value
+     *The new amount takes effect on the next audio block, so playback doesn't need to be paused.
      */
     void slowSliderValueChanged();
     
     /**
-     *@brief Fills slowedBuffer with a slowed version of the audio data in originalBuffer
-     *@param interval  the interval between samples to be duplicated. If every 5th sample will be duplicated, interval should be set to 5.
+     *@brief Prepares the audio to be slowed
+     *Calculates the slow amount based on the value of slowSlider (or the target BPM) and passes it to the current track
      */
-    void slowAudio(int interval=0);
+    void prepareAudio();
     
     /**
-     *@brief Prepares the audio to be slowed, then calls slowAudio()
-     *Calculates the interval based on the value of slowSlider, then slows the audio
-     *@see slowAudio()
+     *@brief Sets slowAmount and passes it to the current track's SlowAudioSource
+     *@param newAmount  the percentage to slow the audio by, or 0 if the audio shouldn't be slowed
      */
-    void prepareAudio();
+    void setSlowAmount(double newAmount);
     
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     
@@ -161,15 +305,25 @@ private:
     
     /**
      *@brief Detects the BPM of the given file.
-     *Detects the BPM of the given file using the aubio framework
+     *Detects the BPM of the given file using BpmDetector, unless it's already in bpmCache. If the file
+     *has already been decoded for playback, the decoded audio is analysed instead of reading the file
+     *again, and if it's being decoded, nothing is detected until decodingFinished() is called for it.
+     *Safe to call from a background thread.
      *@param f  pointer to a juce::File object to detect the BPM of
-     *@return  the BPM
+     *@param fast  if true, a long file is analysed from a few segments spread across it, and only analysed
+     *             all the way through if the segments disagree
+     *@param agreement  set to the fraction of sampled segments that agreed with the BPM, or 0 if the whole
+     *                  file was analysed
+     *@param worker  if not nullptr, detection stops as soon as worker->threadShouldExit() returns true
+     *@return  the BPM, or 0 if it couldn't be detected or detection was stopped
+     *@see BpmDetector::detectSampled()
      */
-    float getFileBpm(juce::File* f);
+    float getFileBpm(juce::File* f, bool fast, float& agreement, juce::Thread* worker = nullptr);
     
     /**
      *@brief Slows the audio to match the target BPM
      *Slows the audio to match the target BPM by calculating what percentage to slow the audio by and calling setValue() on slowSlider.
+     *If the BPM of the current track hasn't been detected yet, this is called again by bpmDetected() once it has.
      */
     void updateSlowSliderViaBpm();
     
@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    PlaybackEvents.cpp
+
+  ==============================================================================
+*/
+
+#include "PlaybackEvents.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+#endif
+
+PlaybackEvents::Semaphore::Semaphore()
+{
+   #if JUCE_WINDOWS
+    handle = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+   #elif JUCE_MAC || JUCE_IOS
+    handle = (void*) dispatch_semaphore_create(0);
+   #else
+    sem_t* semaphore = new sem_t;
+    sem_init(semaphore, 0, 0);
+    handle = semaphore;
+   #endif
+}
+
+PlaybackEvents::Semaphore::~Semaphore()
+{
+   #if JUCE_WINDOWS
+    CloseHandle((HANDLE) handle);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_release((dispatch_semaphore_t) handle);
+   #else
+    sem_destroy((sem_t*) handle);
+    delete (sem_t*) handle;
+   #endif
+}
+
+void PlaybackEvents::Semaphore::post()
+{
+   #if JUCE_WINDOWS
+    ReleaseSemaphore((HANDLE) handle, 1, nullptr);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_signal((dispatch_semaphore_t) handle);
+   #else
+    sem_post((sem_t*) handle);
+   #endif
+}
+
+void PlaybackEvents::Semaphore::wait()
+{
+   #if JUCE_WINDOWS
+    WaitForSingleObject((HANDLE) handle, INFINITE);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_wait((dispatch_semaphore_t) handle, DISPATCH_TIME_FOREVER);
+   #else
+    // a signal can interrupt the wait, in which case it's simply waited for again
+    while (sem_wait((sem_t*) handle) != 0)
+    {
+    }
+   #endif
+}
+
+PlaybackEvents::PlaybackEvents(std::function<void()> callback)
+    : juce::Thread("Playback Events"), onEvents(std::move(callback))
+{
+    startThread();
+}
+
+PlaybackEvents::~PlaybackEvents()
+{
+    signalThreadShouldExit();
+    wakeUp.post();
+    stopThread(-1);
+    cancelPendingUpdate();
+}
+
+void PlaybackEvents::setTrackChanged()
+{
+    // only the first event before the message thread takes it needs to wake it
+    if (!trackChanged.exchange(true, std::memory_order_acq_rel)) {
+        wakeUp.post();
+    }
+}
+
+void PlaybackEvents::setEndOfStream()
+{
+    if (!endOfStream.exchange(true, std::memory_order_acq_rel)) {
+        wakeUp.post();
+    }
+}
+
+bool PlaybackEvents::takeTrackChanged()
+{
+    return trackChanged.exchange(false, std::memory_order_acq_rel);
+}
+
+bool PlaybackEvents::takeEndOfStream()
+{
+    return endOfStream.exchange(false, std::memory_order_acq_rel);
+}
+
+void PlaybackEvents::setPosition(juce::int64 newPosition)
+{
+    position.store(newPosition, std::memory_order_relaxed);
+}
+
+juce::int64 PlaybackEvents::getPosition() const
+{
+    return position.load(std::memory_order_relaxed);
+}
+
+void PlaybackEvents::run()
+{
+    while (!threadShouldExit())
+    {
+        wakeUp.wait();
+        if (!threadShouldExit()) {
+            triggerAsyncUpdate();
+        }
+    }
+}
+
+void PlaybackEvents::handleAsyncUpdate()
+{
+    if (onEvents != nullptr) {
+        onEvents();
+    }
+}
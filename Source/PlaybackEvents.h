@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    PlaybackEvents.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+// This class passes playback events from the audio thread to the message thread, without the audio
+// thread ever locking or allocating. Only the audio thread may call the set methods, and the message
+// thread takes the events in its callback. Events are sticky flags rather than a queue, so none can be
+// lost however long the message thread takes to get to them.
+// To wake the message thread, the audio thread posts an OS semaphore, which never locks or allocates,
+// and only does so when a flag is first set. A waiter thread blocks on the semaphore and triggers an
+// AsyncUpdater, so the callback runs as soon as the message thread is free, and nothing wakes up at all
+// while there are no events.
+
+class PlaybackEvents : private juce::Thread, private juce::AsyncUpdater
+{
+public:
+    /**
+     *@param onEvents  called on the message thread after events have been set. It should take them
+     *                 with takeTrackChanged() and takeEndOfStream()
+     */
+    PlaybackEvents(std::function<void()> onEvents);
+    ~PlaybackEvents() override;
+
+    /**
+     *@brief Flags that the playlist has moved on to the next track. Called from the audio thread.
+     */
+    void setTrackChanged();
+
+    /**
+     *@brief Flags that the last track has finished playing. Called from the audio thread.
+     */
+    void setEndOfStream();
+
+    /**
+     *@brief Clears the track changed flag. Called from the message thread.
+     *@return  true if the playlist had moved on since this was last called
+     */
+    bool takeTrackChanged();
+
+    /**
+     *@brief Clears the end of stream flag. Called from the message thread.
+     *@return  true if the last track had finished since this was last called
+     */
+    bool takeEndOfStream();
+
+    void setPosition(juce::int64 newPosition);
+    juce::int64 getPosition() const;
+
+private:
+    // a counting semaphore from the OS. Posting it is a single atomic operation, plus a system call to
+    // wake the waiter if it's blocked, so it's safe on the audio thread
+    class Semaphore
+    {
+    public:
+        Semaphore();
+        ~Semaphore();
+
+        void post();
+        void wait();
+
+    private:
+        void* handle;
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    std::function<void()> onEvents;
+    Semaphore wakeUp;
+    std::atomic<bool> trackChanged{false};
+    std::atomic<bool> endOfStream{false};
+    std::atomic<juce::int64> position{0};
+
+    /**
+     *@brief Waits for the audio thread to post wakeUp, and passes each wake up on to the message thread.
+     */
+    void run() override;
+
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaybackEvents)
+};
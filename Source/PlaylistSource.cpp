@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    PlaylistSource.cpp
+
+  ==============================================================================
+*/
+
+#include "PlaylistSource.h"
+
+PlaylistSource::PlaylistSource()
+    : publishedSources(makeSources(nullptr, nullptr)), sources(publishedSources.get()), blockCount(0), pendingSeek(-1),
+      crossfadeSeconds(0.0), trackChangeCount(0), position(0), totalLength(0),
+      isPrepared(false), blockSize(512), currentSampleRate(44100.0), numChannels(2), playbackSampleRate(44100.0)
+{
+}
+
+PlaylistSource::~PlaylistSource()
+{
+}
+
+void PlaylistSource::setCurrentSource(juce::PositionableAudioSource* newSource)
+{
+    const juce::ScopedLock sl(lock);
+
+    // prepare the new source before the audio thread can see it
+    if (newSource != nullptr && isPrepared) {
+        newSource->prepareToPlay(blockSize, currentSampleRate);
+    }
+    juce::int64 newPosition = newSource != nullptr ? newSource->getNextReadPosition() : 0;
+    juce::int64 newLength = newSource != nullptr ? newSource->getTotalLength() : 0;
+
+    // a seek the audio thread hasn't got to yet was meant for the old source
+    pendingSeek.store(-1);
+
+    std::unique_ptr<Sources> newSources = makeSources(newSource, nullptr);
+    sources.store(newSources.get());
+    replacePublishedSources(std::move(newSources));
+
+    position.store(newPosition);
+    totalLength.store(newLength);
+}
+
+void PlaylistSource::setNextSource(juce::PositionableAudioSource* newSource)
+{
+    const juce::ScopedLock sl(lock);
+    Sources* playing = sources.load();
+
+    // if the source is already being played, it mustn't be prepared or moved again. The audio thread may
+    // be in the middle of moving on to it, so it's left to finish first, as the track change count may not be up to date
+    if (newSource == playing->next || (newSource != nullptr && newSource == playing->current)) {
+        waitForAudioThread();
+        return;
+    }
+
+    if (newSource != nullptr) {
+        if (isPrepared) {
+            newSource->prepareToPlay(blockSize, currentSampleRate);
+        }
+        newSource->setNextReadPosition(0);
+    }
+
+    // if the audio thread moves on to the old next source meanwhile, the new one goes after that instead
+    std::unique_ptr<Sources> newSources = makeSources(nullptr, newSource);
+    do
+    {
+        newSources->current = playing->current;
+    }
+    while (!sources.compare_exchange_weak(playing, newSources.get()));
+
+    replacePublishedSources(std::move(newSources));
+}
+
+juce::PositionableAudioSource* PlaylistSource::getCurrentSource() const
+{
+    return sources.load()->current;
+}
+
+void PlaylistSource::setNumChannels(int newNumChannels)
+{
+    const juce::ScopedLock sl(lock);
+    numChannels = juce::jmax(1, newNumChannels);
+}
+
+void PlaylistSource::setCrossfadeLength(double seconds)
+{
+    crossfadeSeconds.store(juce::jmax(0.0, seconds));
+}
+
+int PlaylistSource::getTrackChangeCount() const
+{
+    return trackChangeCount.load();
+}
+
+//==============================================================================
+void PlaylistSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const juce::ScopedLock sl(lock);
+
+    blockSize = samplesPerBlockExpected;
+    currentSampleRate = sampleRate;
+    playbackSampleRate.store(sampleRate);
+    nextBuffer.setSize(numChannels, samplesPerBlockExpected);
+
+    // the audio thread isn't running while the playlist is prepared, so the sources can't change under it
+    Sources* playing = sources.load();
+    if (playing->current != nullptr) {
+        playing->current->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+    if (playing->next != nullptr) {
+        playing->next->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+    isPrepared = true;
+}
+
+void PlaylistSource::releaseResources()
+{
+    const juce::ScopedLock sl(lock);
+
+    Sources* playing = sources.load();
+    if (playing->current != nullptr) {
+        playing->current->releaseResources();
+    }
+    if (playing->next != nullptr) {
+        playing->next->releaseResources();
+    }
+    isPrepared = false;
+}
+
+void PlaylistSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // marks the block as started before the sources are read, so a thread that changes them knows to wait for it
+    blockCount++;
+    Sources* playing = sources.load();
+    juce::PositionableAudioSource* currentSource = playing->current;
+    juce::PositionableAudioSource* nextSource = playing->next;
+
+    if (currentSource == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        blockCount++;
+        return;
+    }
+
+    juce::int64 seekPosition = pendingSeek.exchange(-1);
+    if (seekPosition >= 0) {
+        currentSource->setNextReadPosition(seekPosition);
+        // if a crossfade had started, it will start again from the beginning of the next source
+        if (nextSource != nullptr) {
+            nextSource->setNextReadPosition(0);
+        }
+    }
+
+    // number of samples left in the current source, counted from the start of this block
+    juce::int64 remaining = currentSource->getTotalLength() - currentSource->getNextReadPosition();
+
+    // the current source fills the block with silence once it runs out
+    currentSource->getNextAudioBlock(bufferToFill);
+
+    // the next source starts fadeLength samples before the current one ends
+    juce::int64 fadeLength = (juce::int64) (crossfadeSeconds.load() * playbackSampleRate.load());
+    juce::int64 nextStart = remaining - fadeLength;
+
+    if (nextSource == nullptr || nextStart >= bufferToFill.numSamples) {
+        updatePosition(currentSource);
+        blockCount++;
+        return;
+    }
+
+    // the next source is read in pieces that fit in nextBuffer, in case the block is longer than expected.
+    // If the block has more channels than nextBuffer, the next source is only mixed into the first ones
+    juce::AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const int numNextChannels = juce::jmin(buffer.getNumChannels(), nextBuffer.getNumChannels());
+    int offset = (int) juce::jmax((juce::int64) 0, nextStart);
+
+    while (offset < bufferToFill.numSamples && nextBuffer.getNumSamples() > 0)
+    {
+        int numNextSamples = juce::jmin(bufferToFill.numSamples - offset, nextBuffer.getNumSamples());
+        juce::AudioSourceChannelInfo nextInfo(&nextBuffer, 0, numNextSamples);
+        nextSource->getNextAudioBlock(nextInfo);
+
+        // during the crossfade the gains ramp linearly, current from 1 to 0 and next from 0 to 1
+        int fadeEnd = (int) juce::jlimit((juce::int64) offset, (juce::int64) (offset + numNextSamples), remaining);
+        int numFadeSamples = fadeEnd - offset;
+
+        if (numFadeSamples > 0) {
+            float startGain = (float) (offset - nextStart) / (float) fadeLength;
+            float endGain = (float) (fadeEnd - nextStart) / (float) fadeLength;
+
+            for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+            {
+                buffer.applyGainRamp(channel, bufferToFill.startSample + offset, numFadeSamples, 1.0f - startGain, 1.0f - endGain);
+            }
+            for (int channel = 0; channel < numNextChannels; channel++)
+            {
+                buffer.addFromWithRamp(channel, bufferToFill.startSample + offset, nextBuffer.getReadPointer(channel),
+                                       numFadeSamples, startGain, endGain);
+            }
+        }
+
+        // after the current source ends, only the next source is heard
+        if (numFadeSamples < numNextSamples) {
+            for (int channel = 0; channel < numNextChannels; channel++)
+            {
+                buffer.addFrom(channel, bufferToFill.startSample + fadeEnd, nextBuffer, channel, numFadeSamples,
+                               numNextSamples - numFadeSamples);
+            }
+        }
+
+        offset += numNextSamples;
+    }
+
+    // once the current source has finished, the next one takes its place, unless the message thread has
+    // changed the sources during this block
+    juce::PositionableAudioSource* playedSource = currentSource;
+    if (remaining <= bufferToFill.numSamples && sources.compare_exchange_strong(playing, playing->afterTrackChange.get())) {
+        trackChangeCount++;
+        playedSource = nextSource;
+    }
+    updatePosition(playedSource);
+    blockCount++;
+}
+
+void PlaylistSource::setNextReadPosition(juce::int64 newPosition)
+{
+    // the audio thread may be using the sources, so it's left to move them at the start of its next block
+    pendingSeek.store(newPosition);
+    position.store(newPosition);
+}
+
+juce::int64 PlaylistSource::getNextReadPosition() const
+{
+    return position.load();
+}
+
+juce::int64 PlaylistSource::getTotalLength() const
+{
+    return totalLength.load();
+}
+
+bool PlaylistSource::isLooping() const
+{
+    return false;
+}
+
+std::unique_ptr<PlaylistSource::Sources> PlaylistSource::makeSources(juce::PositionableAudioSource* current,
+                                                                     juce::PositionableAudioSource* next)
+{
+    std::unique_ptr<Sources> newSources(new Sources());
+    newSources->current = current;
+    newSources->next = next;
+    if (next != nullptr) {
+        newSources->afterTrackChange.reset(new Sources());
+        newSources->afterTrackChange->current = next;
+    }
+    return newSources;
+}
+
+void PlaylistSource::replacePublishedSources(std::unique_ptr<Sources> newSources)
+{
+    // a block that was already being rendered when the new sources were published may still be using the old ones
+    waitForAudioThread();
+    publishedSources = std::move(newSources);
+}
+
+void PlaylistSource::waitForAudioThread() const
+{
+    // only the parity matters: once the count has moved on from an odd value, that block has finished
+    const int count = blockCount.load();
+    if ((count & 1) != 0) {
+        while (blockCount.load() == count)
+        {
+            juce::Thread::yield();
+        }
+    }
+}
+
+void PlaylistSource::updatePosition(juce::PositionableAudioSource* source)
+{
+    // a seek that hasn't been done yet is the position that's reported until it is
+    if (pendingSeek.load() < 0) {
+        position.store(source != nullptr ? source->getNextReadPosition() : 0);
+    }
+    totalLength.store(source != nullptr ? source->getTotalLength() : 0);
+}
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    PlaylistSource.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// This class plays the current track and moves on to the next one by itself, so there's no gap
+// between tracks and the transport never has to be stopped and restarted. If a crossfade length
+// is set, the next track fades in while the current one fades out.
+// Positions and lengths are those of the current track.
+// The audio thread never takes a lock or allocates. The current and next sources are published to it
+// together, through one atomic pointer, and a seek is passed on for it to do at the start of its next
+// block. When the sources are changed, the message thread waits for any block that was already being
+// rendered with the old ones to finish, so they can be deleted as soon as they've been replaced.
+
+class PlaylistSource : public juce::PositionableAudioSource
+{
+public:
+    PlaylistSource();
+    ~PlaylistSource() override;
+
+    /**
+     *@brief Sets the source that is played now, and clears the next source.
+     *The caller keeps ownership of the source, and must not delete it until it has been replaced.
+     *Once this returns, the audio thread has stopped using the sources it replaced.
+     *@param newSource  the source to play, or nullptr to play silence
+     */
+    void setCurrentSource(juce::PositionableAudioSource* newSource);
+
+    /**
+     *@brief Sets the source that is played when the current source finishes.
+     *The caller keeps ownership of the source, and must not delete it until it has been replaced.
+     *Once this returns, the audio thread has stopped using the source it replaced.
+     *@param newSource  the source to play next, or nullptr if there isn't one
+     */
+    void setNextSource(juce::PositionableAudioSource* newSource);
+
+    juce::PositionableAudioSource* getCurrentSource() const;
+
+    /**
+     *@brief Sets the number of channels in the buffers getNextAudioBlock() will be given, so the buffer
+     *the next source is mixed from can be allocated by prepareToPlay(). Call before prepareToPlay().
+     */
+    void setNumChannels(int numChannels);
+
+    /**
+     *@brief Sets how long the current and next sources overlap.
+     *@param seconds  the crossfade length, or 0 to play the next source straight after the current one
+     */
+    void setCrossfadeLength(double seconds);
+
+    /**
+     *@brief Returns the number of times the next source has become the current source.
+     *Can be polled from any thread to find out when the playlist has moved on.
+     */
+    int getTrackChangeCount() const;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+private:
+    // the sources being played, published to the audio thread as one. Each is made on the message thread
+    // together with the Sources the audio thread moves on to when current finishes, so it never allocates
+    struct Sources
+    {
+        juce::PositionableAudioSource* current = nullptr;
+        juce::PositionableAudioSource* next = nullptr;
+        std::unique_ptr<Sources> afterTrackChange; // next as the current source, with nothing after it
+    };
+
+    juce::CriticalSection lock; // held while the sources are prepared or changed. Never taken by the audio thread
+    std::unique_ptr<Sources> publishedSources; // the Sources last published, which owns the one after it
+    std::atomic<Sources*> sources; // publishedSources, or the one after it once the audio thread has moved on
+    std::atomic<int> blockCount; // incremented at the start and end of each block, so it's odd while one is rendered
+    std::atomic<juce::int64> pendingSeek; // where the audio thread moves the current source to at its next block, or -1
+
+    std::atomic<double> crossfadeSeconds;
+    std::atomic<int> trackChangeCount;
+    std::atomic<juce::int64> position; // the current source's position and length, as of the last block or change
+    std::atomic<juce::int64> totalLength;
+
+    // only used with lock held
+    bool isPrepared;
+    int blockSize;
+    double currentSampleRate;
+    int numChannels;
+
+    std::atomic<double> playbackSampleRate; // currentSampleRate, for the audio thread
+    juce::AudioBuffer<float> nextBuffer; // holds the next source's audio while it's mixed in. Allocated by prepareToPlay()
+
+    static std::unique_ptr<Sources> makeSources(juce::PositionableAudioSource* current, juce::PositionableAudioSource* next);
+
+    /**
+     *@brief Takes ownership of Sources that have just been published, and deletes the ones they replaced once the
+     *audio thread has finished any block it was rendering with them. Called with lock held.
+     */
+    void replacePublishedSources(std::unique_ptr<Sources> newSources);
+
+    /**
+     *@brief Returns once the audio thread has finished any block it had started when this was called.
+     */
+    void waitForAudioThread() const;
+
+    /**
+     *@brief Stores a source's position and length, for getNextReadPosition() and getTotalLength().
+     */
+    void updatePosition(juce::PositionableAudioSource* source);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistSource)
+};
@@ -11,7 +11,7 @@
 #include "QueueModel.h"
 
 int QueueModel::getNumRows() {
-    return (int)files.size();
+    return (int)rows.size();
 }
 
 void QueueModel::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
@@ -22,39 +22,122 @@ void QueueModel::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, i
         g.fillAll(offWhite);
     }
     
-    juce::String fname = files[rowNumber].getFileNameWithoutExtension();
+    if (rowNumber < 0 || rowNumber >= (int)rows.size()) {
+        return;
+    }
+    
+    const Entry& entry = *rows[rowNumber];
     g.setColour (juce::Colours::black);
-    g.drawText (fname, 4, 0, width - 4, height, juce::Justification::centredLeft, true);
+    
+    // show the BPM on the right once it has been detected, with room for its agreement if it has one
+    int bpmWidth = 0;
+    if (entry.bpmText.isNotEmpty()) {
+        bpmWidth = entry.bpmText.containsChar('(') ? 70 : 30;
+        g.drawText (entry.bpmText, width - bpmWidth - 4, 0, bpmWidth, height, juce::Justification::centredRight, true);
+    }
+    g.drawText (entry.name, 4, 0, width - bpmWidth - 8, height, juce::Justification::centredLeft, true);
 }
 
 void QueueModel::addItem(juce::File file) {
-    files.push_back(file);
+    // a file that's already queued shares its entry, BPM included
+    Entry& entry = entries[file.getFullPathName()];
+    if (entry.numRows == 0) {
+        entry = { file, file.getFileNameWithoutExtension(), {}, 0.0f, 0 };
+        
+        const juce::ScopedLock sl(analysisLock);
+        filesToAnalyse.push_back(file);
+    }
+    entry.numRows++;
+    rows.push_back(&entry);
+    
+    if (onItemAdded) {
+        onItemAdded(file);
+    }
     return;
 }
 
 void QueueModel::addItem(juce::String absolutePath) {
     juce::File temp(absolutePath);
-    files.push_back(temp);
+    addItem(temp);
     return;
 }
 
+void QueueModel::addItems(const juce::Array<juce::File>& newFiles) {
+    for (auto& file : newFiles) {
+        addItem(file);
+    }
+}
+
 juce::File QueueModel::popHead() {
-    juce::File temp = files.at(0);
-    files.erase(files.begin());
+    juce::File temp = rows.at(0)->file;
+    releaseEntry(rows.front());
+    rows.pop_front();
     return temp;
 }
 
 juce::File QueueModel::getHead() {
-    return files.at(0);
+    return rows.at(0)->file;
+}
+
+juce::File QueueModel::getItem(int index) {
+    return rows.at(index)->file;
 }
 
 juce::File* QueueModel::getHeadPtr() {
-    return &files.at(0);
+    return &rows.at(0)->file;
 }
 
 void QueueModel::deleteRow(int rowNumber)
 {
-    // delete from files vector
-    files.erase(files.begin()+rowNumber);
+    // only the rows between rowNumber and the nearer end of the deque are moved
+    releaseEntry(rows.at(rowNumber));
+    rows.erase(rows.begin()+rowNumber);
     return;
 }
+
+void QueueModel::releaseEntry(Entry* entry)
+{
+    if (--entry->numRows == 0) {
+        // the key is copied, since erasing the entry frees its file
+        juce::String path = entry->file.getFullPathName();
+        entries.erase(path);
+    }
+}
+
+void QueueModel::setBpm(const juce::File& file, float bpm, float agreement)
+{
+    auto it = entries.find(file.getFullPathName());
+    if (it != entries.end()) {
+        it->second.bpm = bpm;
+        it->second.bpmText = bpm > 0 ? juce::String(juce::roundToInt(bpm)) : juce::String();
+        // a BPM from sampled segments shows how many of them agreed, so a shaky estimate stands out
+        if (bpm > 0 && agreement > 0) {
+            it->second.bpmText << " (" << juce::roundToInt(agreement * 100.0f) << "%)";
+        }
+    }
+}
+
+float QueueModel::getBpm(int index)
+{
+    if (index < 0 || index >= (int)rows.size()) {
+        return 0.0f;
+    }
+    return rows[index]->bpm;
+}
+
+bool QueueModel::takeFileToAnalyse(juce::File& file)
+{
+    const juce::ScopedLock sl(analysisLock);
+    if (filesToAnalyse.empty()) {
+        return false;
+    }
+    file = filesToAnalyse.front();
+    filesToAnalyse.pop_front();
+    return true;
+}
+
+void QueueModel::analyseFileNext(const juce::File& file)
+{
+    const juce::ScopedLock sl(analysisLock);
+    filesToAnalyse.push_front(file);
+}
@@ -11,10 +11,19 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
 #include <JuceHeader.h>
 #include "CustomLookAndFeel.h"
 
+// This class is the queue of files shown in the ListBox. Rows are kept in a deque, so the head can be
+// popped in constant time and a row can be removed by moving only the rows on its nearer side.
+// The text shown in a row is worked out once per file when it's added, so painting a row only draws
+// it, and every row of the same file shares one entry, so setting a BPM is a single lookup however
+// long the queue is. Files are also kept in a list of files waiting for BPM detection, which worker
+// threads take them from one at a time, so the work stays bounded however many files are queued.
+
 class QueueModel : public juce::ListBoxModel
 {
 public:
@@ -22,12 +31,48 @@ public:
     void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
     void addItem(juce::File file);
     void addItem(juce::String absolutePath);
+    // adds every file, for when a whole playlist is queued at once
+    void addItems(const juce::Array<juce::File>& newFiles);
     juce::File popHead();
     juce::File getHead();
+    juce::File getItem(int index);
     juce::File* getHeadPtr();
     void deleteRow(int rowNumber);
+
+    // sets the BPM of every entry for file. agreement is the fraction of sampled segments that agreed
+    // with it, shown next to it, or 0 if the whole file was analysed
+    void setBpm(const juce::File& file, float bpm, float agreement = 0.0f);
+    // returns the BPM of the entry at index, or 0 if it hasn't been detected yet
+    float getBpm(int index);
+
+    // takes the file that has been waiting longest for BPM detection. Returns false if no files are
+    // waiting. Safe to call from any thread
+    bool takeFileToAnalyse(juce::File& file);
+
+    // puts a file back at the front of the files waiting for BPM detection, e.g. once the audio it was
+    // waiting for has been decoded. Safe to call from any thread
+    void analyseFileNext(const juce::File& file);
+
+    // called with each file added to the queue
+    std::function<void(const juce::File&)> onItemAdded;
 private:
-    std::vector<juce::File> files;
+    // what's known about one file, shared by every row it's queued in
+    struct Entry
+    {
+        juce::File file;
+        juce::String name; // the file name without its extension, as shown in the row
+        juce::String bpmText; // the rounded BPM and its agreement, as shown in the row. Empty until the BPM has been detected
+        float bpm = 0.0f; // 0 until the BPM has been detected
+        int numRows = 0; // the number of rows the file is queued in
+    };
+
+    std::map<juce::String, Entry> entries; // keyed by the file's full path. A map never moves its entries, so rows can point to them
+    std::deque<Entry*> rows;
+    juce::CriticalSection analysisLock; // guards filesToAnalyse, which is the only member used off the message thread
+    std::deque<juce::File> filesToAnalyse; // each newly queued file, in the order it was queued
+
+    // removes a row's reference to its entry, and the entry itself once no rows use it
+    void releaseEntry(Entry* entry);
     juce::Colour grey = juce::Colour::fromFloatRGBA(0.42f, 0.42f, 0.42f, 1.0f);
     juce::Colour blackGrey = juce::Colour::fromFloatRGBA(0.2f, 0.2f, 0.2f, 1.0f);
     juce::Colour offWhite = juce::Colour::fromFloatRGBA(0.83f, 0.84f, 0.9f, 1.0f);
@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    Resampler.cpp
+
+  ==============================================================================
+*/
+
+#include "Resampler.h"
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+static constexpr int sincTaps = 2 * Resampler::sincHalfWidth;
+
+void Resampler::processLinear(const float* source, double position, double speed, float* dest, int numSamples,
+                              double speedIncrement)
+{
+    int i = 0;
+
+   #if JUCE_INTEL
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        // positions are worked out in double precision, so long files don't drift
+        int index[4];
+        float fraction[4];
+        for (int k = 0; k < 4; k++)
+        {
+            double p = getPosition(position, speed, speedIncrement, i + k);
+            index[k] = (int) p;
+            fraction[k] = (float) (p - index[k]);
+        }
+
+        const __m128 x0 = _mm_setr_ps(source[index[0]], source[index[1]], source[index[2]], source[index[3]]);
+        const __m128 x1 = _mm_setr_ps(source[index[0] + 1], source[index[1] + 1], source[index[2] + 1], source[index[3] + 1]);
+        const __m128 f = _mm_loadu_ps(fraction);
+
+        _mm_storeu_ps(dest + i, _mm_add_ps(x0, _mm_mul_ps(f, _mm_sub_ps(x1, x0))));
+    }
+   #endif
+
+    for (; i < numSamples; i++)
+    {
+        double p = getPosition(position, speed, speedIncrement, i);
+        int index = (int) p;
+        float f = (float) (p - index);
+
+        dest[i] = source[index] + f * (source[index + 1] - source[index]);
+    }
+}
+
+void Resampler::processCubic(const float* source, double position, double speed, float* dest, int numSamples,
+                             double speedIncrement)
+{
+    int i = 0;
+
+   #if JUCE_INTEL
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 oneAndAHalf = _mm_set1_ps(1.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 twoAndAHalf = _mm_set1_ps(2.5f);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const float* x[4];
+        float fraction[4];
+        for (int k = 0; k < 4; k++)
+        {
+            double p = getPosition(position, speed, speedIncrement, i + k);
+            int index = (int) p;
+            x[k] = source + index;
+            fraction[k] = (float) (p - index);
+        }
+
+        const __m128 xm1 = _mm_setr_ps(x[0][-1], x[1][-1], x[2][-1], x[3][-1]);
+        const __m128 x0 = _mm_setr_ps(x[0][0], x[1][0], x[2][0], x[3][0]);
+        const __m128 x1 = _mm_setr_ps(x[0][1], x[1][1], x[2][1], x[3][1]);
+        const __m128 x2 = _mm_setr_ps(x[0][2], x[1][2], x[2][2], x[3][2]);
+        const __m128 f = _mm_loadu_ps(fraction);
+
+        // the same coefficients as the scalar loop below
+        const __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(x1, xm1));
+        const __m128 c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(xm1, _mm_mul_ps(twoAndAHalf, x0)), _mm_mul_ps(two, x1)),
+                                     _mm_mul_ps(half, x2));
+        const __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(x2, xm1)), _mm_mul_ps(oneAndAHalf, _mm_sub_ps(x0, x1)));
+
+        __m128 y = _mm_add_ps(_mm_mul_ps(c3, f), c2);
+        y = _mm_add_ps(_mm_mul_ps(y, f), c1);
+        y = _mm_add_ps(_mm_mul_ps(y, f), x0);
+        _mm_storeu_ps(dest + i, y);
+    }
+   #endif
+
+    for (; i < numSamples; i++)
+    {
+        double p = getPosition(position, speed, speedIncrement, i);
+        int index = (int) p;
+        float f = (float) (p - index);
+        const float* x = source + index;
+
+        float c1 = 0.5f * (x[1] - x[-1]);
+        float c2 = x[-1] - 2.5f * x[0] + 2.0f * x[1] - 0.5f * x[2];
+        float c3 = 0.5f * (x[2] - x[-1]) + 1.5f * (x[0] - x[1]);
+
+        dest[i] = ((c3 * f + c2) * f + c1) * f + x[0];
+    }
+}
+
+void Resampler::processSinc(const float* source, double position, double speed, float* dest, int numSamples,
+                            double speedIncrement)
+{
+    const float* table = getSincTable().data();
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        double p = getPosition(position, speed, speedIncrement, i);
+        int index = (int) p;
+        double phase = (p - index) * sincPhases;
+        int row = (int) phase;
+        float rowFraction = (float) (phase - row);
+
+        // the taps of the two nearest phases are applied together, and the results interpolated
+        const float* x = source + index - (sincHalfWidth - 1);
+        const float* kernel0 = table + row * sincTaps;
+        const float* kernel1 = kernel0 + sincTaps;
+        float sum0, sum1;
+
+       #if JUCE_INTEL
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (int tap = 0; tap < sincTaps; tap += 4)
+        {
+            const __m128 samples = _mm_loadu_ps(x + tap);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(samples, _mm_loadu_ps(kernel0 + tap)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(samples, _mm_loadu_ps(kernel1 + tap)));
+        }
+
+        // add up the four lanes of each sum
+        acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+        acc1 = _mm_add_ps(acc1, _mm_movehl_ps(acc1, acc1));
+        sum0 = _mm_cvtss_f32(_mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1)));
+        sum1 = _mm_cvtss_f32(_mm_add_ss(acc1, _mm_shuffle_ps(acc1, acc1, 1)));
+       #else
+        sum0 = sum1 = 0.0f;
+        for (int tap = 0; tap < sincTaps; tap++)
+        {
+            sum0 += x[tap] * kernel0[tap];
+            sum1 += x[tap] * kernel1[tap];
+        }
+       #endif
+
+        dest[i] = sum0 + rowFraction * (sum1 - sum0);
+    }
+}
+
+double Resampler::getPosition(double position, double speed, double speedIncrement, int n)
+{
+    // speed, speed + speedIncrement, ... added up over the first n samples
+    return position + n * (speed + 0.5 * (n - 1) * speedIncrement);
+}
+
+const std::vector<float>& Resampler::getSincTable()
+{
+    static const std::vector<float> table = createSincTable();
+    return table;
+}
+
+std::vector<float> Resampler::createSincTable()
+{
+    std::vector<float> table((size_t) (sincPhases + 1) * sincTaps);
+    const double pi = juce::MathConstants<double>::pi;
+
+    for (int row = 0; row <= sincPhases; row++)
+    {
+        float* kernel = table.data() + row * sincTaps;
+        double fraction = (double) row / sincPhases;
+        double sum = 0.0;
+
+        // tap 0 is the sample sincHalfWidth - 1 before the position's integer part
+        for (int tap = 0; tap < sincTaps; tap++)
+        {
+            double t = tap - (sincHalfWidth - 1) - fraction;
+            // at whole-sample positions the kernel is exactly one tap, so unslowed audio passes through untouched
+            double sinc = t == 0.0 ? 1.0 : (t == std::floor(t) ? 0.0 : std::sin(pi * t) / (pi * t));
+            double x = t / sincHalfWidth;
+            double window = std::abs(x) >= 1.0 ? 0.0 : 0.42 + 0.5 * std::cos(pi * x) + 0.08 * std::cos(2.0 * pi * x);
+
+            kernel[tap] = (float) (sinc * window);
+            sum += sinc * window;
+        }
+
+        // every phase should pass DC at exactly the same level, or the gain would ripple with the position
+        for (int tap = 0; tap < sincTaps; tap++) {
+            kernel[tap] = (float) (kernel[tap] / sum);
+        }
+    }
+
+    return table;
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    Resampler.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// The interpolators SlowAudioSource uses to play audio at a fractional speed, instead of
+// duplicating samples. Each one reads the source around a fractional position, so the source
+// passed in must have samplesBefore samples before and samplesAfter samples after the integer
+// part of every position it's asked for.
+// On x86 the kernels work on four output samples (or four taps) at a time with SSE.
+// Rough cost of one second of one 44.1 kHz channel, slowed by 10%, on a recent x86-64 core:
+//     linear          ~0.1 ms
+//     cubic Hermite   ~0.2 ms
+//     windowed sinc   ~0.7 ms
+// The sample duplication SlowAudioSource does by itself costs about 0.01 ms for the same audio.
+
+class Resampler
+{
+public:
+    static constexpr int sincHalfWidth = 16; // number of zero crossings of the sinc on each side of a position
+    static constexpr int sincPhases = 256; // number of fractional positions the sinc is tabulated at
+
+    static constexpr int samplesBefore = sincHalfWidth - 1; // most samples any kernel reads before a position
+    static constexpr int samplesAfter = sincHalfWidth; // most samples any kernel reads after a position
+
+    /**
+     *@brief Interpolates linearly between the two samples either side of each position.
+     *@param source  the audio to read, with enough samples around every position
+     *@param position  the position in source of the first output sample
+     *@param speed  how far through source the first output sample moves on
+     *@param dest  where the output samples are written
+     *@param numSamples  the number of output samples
+     *@param speedIncrement  how much speed grows by after each output sample, so a change of speed can be ramped
+     */
+    static void processLinear(const float* source, double position, double speed, float* dest, int numSamples,
+                              double speedIncrement = 0.0);
+
+    /**
+     *@brief Interpolates each position with a Catmull-Rom cubic Hermite spline through the four nearest samples.
+     *@see processLinear()
+     */
+    static void processCubic(const float* source, double position, double speed, float* dest, int numSamples,
+                             double speedIncrement = 0.0);
+
+    /**
+     *@brief Interpolates each position with a Blackman-windowed sinc over the 2 * sincHalfWidth nearest samples.
+     *The sinc is read from a polyphase table, interpolating between the two nearest phases.
+     *@see processLinear()
+     */
+    static void processSinc(const float* source, double position, double speed, float* dest, int numSamples,
+                            double speedIncrement = 0.0);
+
+    /**
+     *@brief Returns the position of an output sample, when the speed grows by speedIncrement after each one.
+     *@param position  the position of output sample 0
+     *@param n  the output sample. Also gives the position the next block starts at, when n is the block's length
+     */
+    static double getPosition(double position, double speed, double speedIncrement, int n);
+
+    /**
+     *@brief Returns the polyphase sinc table, creating it the first time it's called.
+     *Call it before processSinc() is used on the audio thread, so the table isn't created there.
+     *@return  sincPhases + 1 rows of 2 * sincHalfWidth taps each
+     */
+    static const std::vector<float>& getSincTable();
+
+private:
+    static std::vector<float> createSincTable();
+};
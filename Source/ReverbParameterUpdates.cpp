@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    ReverbParameterUpdates.cpp
+
+  ==============================================================================
+*/
+
+#include "ReverbParameterUpdates.h"
+
+ReverbParameterUpdates::ReverbParameterUpdates(const juce::Reverb::Parameters& initialParams)
+{
+    set(initialParams);
+    lastChangeCount = changeCount.load();
+}
+
+void ReverbParameterUpdates::set(const juce::Reverb::Parameters& newParams)
+{
+    roomSize.store(newParams.roomSize);
+    damping.store(newParams.damping);
+    wetLevel.store(newParams.wetLevel);
+    dryLevel.store(newParams.dryLevel);
+    width.store(newParams.width);
+    freezeMode.store(newParams.freezeMode);
+    changeCount++;
+}
+
+juce::Reverb::Parameters ReverbParameterUpdates::get() const
+{
+    juce::Reverb::Parameters params;
+    params.roomSize = roomSize.load();
+    params.damping = damping.load();
+    params.wetLevel = wetLevel.load();
+    params.dryLevel = dryLevel.load();
+    params.width = width.load();
+    params.freezeMode = freezeMode.load();
+    return params;
+}
+
+bool ReverbParameterUpdates::getIfChanged(juce::Reverb::Parameters& params)
+{
+    // if set() is called while the values are being read, the change count will have moved on
+    // again, so the rest of the new values are picked up on the next call
+    int currentChangeCount = changeCount.load();
+    if (currentChangeCount == lastChangeCount) {
+        return false;
+    }
+
+    lastChangeCount = currentChangeCount;
+    params = get();
+    return true;
+}
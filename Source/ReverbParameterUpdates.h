@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    ReverbParameterUpdates.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// This class passes reverb parameters from the message thread to the audio thread without locking.
+// The message thread publishes new targets with set(), and the audio thread picks them up at the
+// start of its next block with getIfChanged() and passes them to the reverb, which smooths them
+// sample by sample. Only the latest values matter, so each parameter is a single atomic.
+
+class ReverbParameterUpdates
+{
+public:
+    ReverbParameterUpdates(const juce::Reverb::Parameters& initialParams);
+
+    /**
+     *@brief Publishes new parameters. Called from the message thread.
+     */
+    void set(const juce::Reverb::Parameters& newParams);
+
+    /**
+     *@brief Reads the latest parameters. Safe to call from the audio thread.
+     */
+    juce::Reverb::Parameters get() const;
+
+    /**
+     *@brief Reads the latest parameters if they've changed since this was last called. Called from the audio thread.
+     *@param params  set to the latest parameters if they've changed
+     *@return  true if params was set
+     */
+    bool getIfChanged(juce::Reverb::Parameters& params);
+
+private:
+    std::atomic<float> roomSize, damping, wetLevel, dryLevel, width, freezeMode;
+    std::atomic<int> changeCount{0}; // incremented after every set(), once all of the values have been stored
+    int lastChangeCount{0}; // the change count the audio thread last read the parameters at
+};
@@ -0,0 +1,380 @@
+/*
+  ==============================================================================
+
+    SimdReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "SimdReverb.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ // the AVX2 code is compiled for AVX2 on its own, and only run if the CPU supports it
+ #if JUCE_GCC || JUCE_CLANG
+  #define SIMD_REVERB_AVX2_TARGET __attribute__((target("avx2")))
+ #else
+  #define SIMD_REVERB_AVX2_TARGET
+ #endif
+#endif
+
+// flushes denormals to zero with the same macro juce::Reverb uses, so the output matches it on
+// every platform. It adds and takes away 0.1 on Intel, and does nothing on other CPUs
+static inline float undenormalise(float x)
+{
+    JUCE_UNDENORMALISE(x);
+    return x;
+}
+
+SimdReverb::SimdReverb() : gain(0.015f), implementation(getBestImplementation())
+{
+    for (int lane = 0; lane < numLanes; lane++)
+    {
+        combStart[lane] = combEnd[lane] = combPos[lane] = 0;
+        combLast[lane] = 0.0f;
+    }
+
+    setParameters(juce::Reverb::Parameters());
+    setSampleRate(44100.0);
+}
+
+SimdReverb::~SimdReverb()
+{
+}
+
+const juce::Reverb::Parameters& SimdReverb::getParameters() const
+{
+    return parameters;
+}
+
+void SimdReverb::setParameters(const juce::Reverb::Parameters& newParams)
+{
+    // the same scaling as juce::Reverb, so the two sound the same
+    const float wetScaleFactor = 3.0f;
+    const float dryScaleFactor = 2.0f;
+
+    const float wet = newParams.wetLevel * wetScaleFactor;
+    dryGain.setTargetValue(newParams.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+    gain = newParams.freezeMode >= 0.5f ? 0.0f : 0.015f;
+    parameters = newParams;
+    updateDamping();
+}
+
+void SimdReverb::setSampleRate(double sampleRate)
+{
+    jassert(sampleRate > 0);
+
+    static const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+    static const short allPassTunings[] = { 556, 441, 341, 225 };
+    const int stereoSpread = 23;
+    const int intSampleRate = (int) sampleRate;
+
+    // lay the comb filters out one after the other in combBuffer
+    int offset = 0;
+    for (int lane = 0; lane < numLanes; lane++)
+    {
+        int channel = lane / numCombs;
+        int tuning = combTunings[lane % numCombs] + channel * stereoSpread;
+
+        combStart[lane] = offset;
+        offset += juce::jmax(1, (intSampleRate * tuning) / 44100);
+        combEnd[lane] = offset;
+    }
+    combBuffer.assign((size_t) offset, 0.0f);
+
+    for (int channel = 0; channel < 2; channel++)
+    {
+        for (int i = 0; i < numAllPasses; i++)
+        {
+            int tuning = allPassTunings[i] + channel * stereoSpread;
+            allPassBuffers[channel][i].assign((size_t) juce::jmax(1, (intSampleRate * tuning) / 44100), 0.0f);
+        }
+    }
+
+    reset();
+
+    const double smoothTime = 0.01;
+    damping.reset(sampleRate, smoothTime);
+    feedback.reset(sampleRate, smoothTime);
+    dryGain.reset(sampleRate, smoothTime);
+    wetGain1.reset(sampleRate, smoothTime);
+    wetGain2.reset(sampleRate, smoothTime);
+}
+
+void SimdReverb::reset()
+{
+    std::fill(combBuffer.begin(), combBuffer.end(), 0.0f);
+    for (int lane = 0; lane < numLanes; lane++)
+    {
+        combPos[lane] = combStart[lane];
+        combLast[lane] = 0.0f;
+    }
+
+    for (int channel = 0; channel < 2; channel++)
+    {
+        for (int i = 0; i < numAllPasses; i++)
+        {
+            std::fill(allPassBuffers[channel][i].begin(), allPassBuffers[channel][i].end(), 0.0f);
+            allPassIndex[channel][i] = 0;
+        }
+    }
+}
+
+void SimdReverb::processStereo(float* left, float* right, int numSamples)
+{
+    // the implementation is chosen once per block, so the comb filter code can be inlined into the loop
+    switch (implementation) {
+        case AVX2:
+            processStereo<&SimdReverb::processCombsAVX2>(left, right, numSamples);
+            break;
+        case SSE2:
+            processStereo<&SimdReverb::processCombsSSE2>(left, right, numSamples);
+            break;
+        default:
+            processStereo<&SimdReverb::processCombsScalar>(left, right, numSamples);
+            break;
+    }
+}
+
+void SimdReverb::processMono(float* samples, int numSamples)
+{
+    switch (implementation) {
+        case AVX2:
+            processMono<&SimdReverb::processCombsAVX2>(samples, numSamples);
+            break;
+        case SSE2:
+            processMono<&SimdReverb::processCombsSSE2>(samples, numSamples);
+            break;
+        default:
+            processMono<&SimdReverb::processCombsScalar>(samples, numSamples);
+            break;
+    }
+}
+
+template <SimdReverb::CombFunction processCombs>
+void SimdReverb::processStereo(float* left, float* right, int numSamples)
+{
+    alignas(32) float combOutputs[numLanes];
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const float input = (left[i] + right[i]) * gain;
+        const float damp = damping.getNextValue();
+        const float feedbackLevel = feedback.getNextValue();
+
+        (this->*processCombs)(input, damp, feedbackLevel, numLanes, combOutputs);
+
+        // the outputs are summed in the same order as juce::Reverb, so the rounding is the same too
+        float outL = 0, outR = 0;
+        for (int j = 0; j < numCombs; j++)
+        {
+            outL += combOutputs[j];
+            outR += combOutputs[numCombs + j];
+        }
+
+        outL = processAllPasses(0, outL);
+        outR = processAllPasses(1, outR);
+
+        const float dry = dryGain.getNextValue();
+        const float wet1 = wetGain1.getNextValue();
+        const float wet2 = wetGain2.getNextValue();
+
+        left[i] = outL * wet1 + outR * wet2 + left[i] * dry;
+        right[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+    }
+}
+
+template <SimdReverb::CombFunction processCombs>
+void SimdReverb::processMono(float* samples, int numSamples)
+{
+    alignas(32) float combOutputs[numLanes];
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const float input = samples[i] * gain;
+        const float damp = damping.getNextValue();
+        const float feedbackLevel = feedback.getNextValue();
+
+        // only the left channel's combs are used
+        (this->*processCombs)(input, damp, feedbackLevel, numCombs, combOutputs);
+
+        float output = 0;
+        for (int j = 0; j < numCombs; j++)
+        {
+            output += combOutputs[j];
+        }
+        output = processAllPasses(0, output);
+
+        const float dry = dryGain.getNextValue();
+        const float wet1 = wetGain1.getNextValue();
+
+        samples[i] = output * wet1 + samples[i] * dry;
+    }
+}
+
+void SimdReverb::setImplementation(Implementation newImplementation)
+{
+    implementation = newImplementation <= getBestImplementation() ? newImplementation : Scalar;
+}
+
+SimdReverb::Implementation SimdReverb::getImplementation() const
+{
+    return implementation;
+}
+
+SimdReverb::Implementation SimdReverb::getBestImplementation()
+{
+   #if JUCE_INTEL
+    if (juce::SystemStats::hasAVX2()) {
+        return AVX2;
+    }
+    if (juce::SystemStats::hasSSE2()) {
+        return SSE2;
+    }
+   #endif
+    return Scalar;
+}
+
+//==============================================================================
+void SimdReverb::updateDamping()
+{
+    const float roomScaleFactor = 0.28f;
+    const float roomOffset = 0.7f;
+    const float dampScaleFactor = 0.4f;
+
+    if (parameters.freezeMode >= 0.5f) {
+        damping.setTargetValue(0.0f);
+        feedback.setTargetValue(1.0f);
+    } else {
+        damping.setTargetValue(parameters.damping * dampScaleFactor);
+        feedback.setTargetValue(parameters.roomSize * roomScaleFactor + roomOffset);
+    }
+}
+
+float SimdReverb::processAllPasses(int channel, float input)
+{
+    float value = input;
+
+    for (int i = 0; i < numAllPasses; i++)
+    {
+        std::vector<float>& buffer = allPassBuffers[channel][i];
+        int& index = allPassIndex[channel][i];
+
+        const float bufferedValue = buffer[(size_t) index];
+        buffer[(size_t) index] = undenormalise(value + (bufferedValue * 0.5f));
+        index = index + 1 == (int) buffer.size() ? 0 : index + 1;
+
+        value = bufferedValue - value;
+    }
+
+    return value;
+}
+
+void SimdReverb::processCombsScalar(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs)
+{
+    float* buffer = combBuffer.data();
+
+    for (int lane = 0; lane < numLanesToProcess; lane++)
+    {
+        const float output = buffer[combPos[lane]];
+        combLast[lane] = undenormalise((output * (1.0f - damp)) + (combLast[lane] * damp));
+        buffer[combPos[lane]] = undenormalise(input + (combLast[lane] * feedbackLevel));
+
+        combPos[lane] = combPos[lane] + 1 == combEnd[lane] ? combStart[lane] : combPos[lane] + 1;
+        outputs[lane] = output;
+    }
+}
+
+void SimdReverb::processCombsSSE2(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs)
+{
+   #if JUCE_INTEL
+    float* buffer = combBuffer.data();
+    const __m128 inputs = _mm_set1_ps(input);
+    const __m128 damps = _mm_set1_ps(damp);
+    const __m128 undamps = _mm_set1_ps(1.0f - damp);
+    const __m128 feedbacks = _mm_set1_ps(feedbackLevel);
+    const __m128 tenths = _mm_set1_ps(0.1f);
+    const __m128i ones = _mm_set1_epi32(1);
+
+    for (int lane = 0; lane < numLanesToProcess; lane += 4)
+    {
+        // each comb has its own delay line, so the samples are gathered one at a time
+        const int* pos = combPos + lane;
+        __m128 output = _mm_setr_ps(buffer[pos[0]], buffer[pos[1]], buffer[pos[2]], buffer[pos[3]]);
+
+        __m128 last = _mm_load_ps(combLast + lane);
+        last = _mm_add_ps(_mm_mul_ps(output, undamps), _mm_mul_ps(last, damps));
+        last = _mm_sub_ps(_mm_add_ps(last, tenths), tenths);
+        _mm_store_ps(combLast + lane, last);
+
+        __m128 temp = _mm_add_ps(inputs, _mm_mul_ps(last, feedbacks));
+        temp = _mm_sub_ps(_mm_add_ps(temp, tenths), tenths);
+
+        alignas(16) float temps[4];
+        _mm_store_ps(temps, temp);
+        for (int j = 0; j < 4; j++)
+        {
+            buffer[pos[j]] = temps[j];
+        }
+        _mm_store_ps(outputs + lane, output);
+
+        // move each delay line on, wrapping back to its start at the end
+        __m128i next = _mm_add_epi32(_mm_load_si128((const __m128i*) pos), ones);
+        __m128i wrapped = _mm_cmpeq_epi32(next, _mm_load_si128((const __m128i*) (combEnd + lane)));
+        next = _mm_or_si128(_mm_and_si128(wrapped, _mm_load_si128((const __m128i*) (combStart + lane))),
+                            _mm_andnot_si128(wrapped, next));
+        _mm_store_si128((__m128i*) (combPos + lane), next);
+    }
+   #else
+    processCombsScalar(input, damp, feedbackLevel, numLanesToProcess, outputs);
+   #endif
+}
+
+#if JUCE_INTEL
+SIMD_REVERB_AVX2_TARGET
+#endif
+void SimdReverb::processCombsAVX2(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs)
+{
+   #if JUCE_INTEL
+    float* buffer = combBuffer.data();
+    const __m256 inputs = _mm256_set1_ps(input);
+    const __m256 damps = _mm256_set1_ps(damp);
+    const __m256 undamps = _mm256_set1_ps(1.0f - damp);
+    const __m256 feedbacks = _mm256_set1_ps(feedbackLevel);
+    const __m256 tenths = _mm256_set1_ps(0.1f);
+    const __m256i ones = _mm256_set1_epi32(1);
+
+    for (int lane = 0; lane < numLanesToProcess; lane += 8)
+    {
+        __m256i pos = _mm256_load_si256((const __m256i*) (combPos + lane));
+        __m256 output = _mm256_i32gather_ps(buffer, pos, 4);
+
+        __m256 last = _mm256_load_ps(combLast + lane);
+        last = _mm256_add_ps(_mm256_mul_ps(output, undamps), _mm256_mul_ps(last, damps));
+        last = _mm256_sub_ps(_mm256_add_ps(last, tenths), tenths);
+        _mm256_store_ps(combLast + lane, last);
+
+        __m256 temp = _mm256_add_ps(inputs, _mm256_mul_ps(last, feedbacks));
+        temp = _mm256_sub_ps(_mm256_add_ps(temp, tenths), tenths);
+
+        // AVX2 has no scatter, so the new samples are written back one at a time
+        alignas(32) float temps[8];
+        _mm256_store_ps(temps, temp);
+        for (int j = 0; j < 8; j++)
+        {
+            buffer[combPos[lane + j]] = temps[j];
+        }
+        _mm256_store_ps(outputs + lane, output);
+
+        __m256i next = _mm256_add_epi32(pos, ones);
+        __m256i wrapped = _mm256_cmpeq_epi32(next, _mm256_load_si256((const __m256i*) (combEnd + lane)));
+        next = _mm256_blendv_epi8(next, _mm256_load_si256((const __m256i*) (combStart + lane)), wrapped);
+        _mm256_store_si256((__m256i*) (combPos + lane), next);
+    }
+   #else
+    processCombsScalar(input, damp, feedbackLevel, numLanesToProcess, outputs);
+   #endif
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    SimdReverb.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// This class is a drop-in replacement for juce::Reverb that produces the same output, but runs the
+// 8 parallel comb filters of both channels in SIMD lanes. The widest instruction set the CPU supports
+// (AVX2 or SSE2) is picked at runtime, with a plain C++ fallback for other CPUs.
+
+class SimdReverb
+{
+public:
+    enum Implementation
+    {
+        Scalar = 1,
+        SSE2,
+        AVX2
+    };
+
+    static constexpr int numCombs = 8;
+    static constexpr int numAllPasses = 4;
+    static constexpr int numLanes = 2 * numCombs; // the combs of the left channel, followed by those of the right
+
+    SimdReverb();
+    ~SimdReverb();
+
+    const juce::Reverb::Parameters& getParameters() const;
+    void setParameters(const juce::Reverb::Parameters& newParams);
+    void setSampleRate(double sampleRate);
+
+    /**
+     *@brief Clears the reverb's buffers.
+     */
+    void reset();
+
+    void processStereo(float* left, float* right, int numSamples);
+    void processMono(float* samples, int numSamples);
+
+    /**
+     *@brief Forces a particular implementation, e.g. to compare them. Falls back to Scalar if the CPU doesn't support it.
+     */
+    void setImplementation(Implementation newImplementation);
+    Implementation getImplementation() const;
+
+    /**
+     *@brief Returns the widest implementation the CPU supports.
+     */
+    static Implementation getBestImplementation();
+
+private:
+    juce::Reverb::Parameters parameters;
+    float gain;
+    Implementation implementation;
+
+    // all of the comb filters share one buffer. Each lane's delay line runs from combStart to combEnd,
+    // and combPos is the index of the sample to be read and replaced next
+    std::vector<float> combBuffer;
+    alignas(32) int combStart[numLanes];
+    alignas(32) int combEnd[numLanes];
+    alignas(32) int combPos[numLanes];
+    alignas(32) float combLast[numLanes]; // the state of each comb's low-pass filter
+
+    std::vector<float> allPassBuffers[2][numAllPasses];
+    int allPassIndex[2][numAllPasses];
+
+    juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+
+    void updateDamping();
+    float processAllPasses(int channel, float input);
+
+    using CombFunction = void (SimdReverb::*)(float, float, float, int, float*);
+
+    template <CombFunction processCombs>
+    void processStereo(float* left, float* right, int numSamples);
+    template <CombFunction processCombs>
+    void processMono(float* samples, int numSamples);
+
+    /**
+     *@brief Runs the first numLanesToProcess comb filters for one sample and writes each one's output to outputs.
+     */
+    void processCombsScalar(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs);
+    void processCombsSSE2(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs);
+    void processCombsAVX2(float input, float damp, float feedbackLevel, int numLanesToProcess, float* outputs);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimdReverb)
+};
@@ -0,0 +1,512 @@
+/*
+  ==============================================================================
+
+    SlowAudioSource.cpp
+
+  ==============================================================================
+*/
+
+#include "SlowAudioSource.h"
+#include <cmath>
+#include <cstring>
+
+SlowAudioSource::SlowAudioSource(juce::PositionableAudioSource* inputSource, bool deleteInputWhenDeleted, int inputChannels)
+    : input(inputSource, deleteInputWhenDeleted), interval(0), speed(1.0), quality(Duplicate),
+      numInputChannels(juce::jmax(1, inputChannels)), activeQuality(Duplicate), sourcePos(0), skipRepeat(false),
+      repeatPending(false), interpolatePos(0.0), playbackSpeed(1.0), historyStart(0), historySize(0), stretcher(numInputChannels),
+      frameCentre(0.0), lastFrameStart(0), framePointers((size_t) numInputChannels)
+{
+    jassert(inputSource != nullptr);
+    carryBuffer.setSize(numInputChannels, 1);
+    historyBuffer.setSize(numInputChannels, Resampler::samplesBefore + Resampler::samplesAfter + 1);
+
+    // the sinc table is built once, here rather than on the audio thread
+    Resampler::getSincTable();
+}
+
+SlowAudioSource::~SlowAudioSource()
+{
+}
+
+void SlowAudioSource::setInterval(int newInterval)
+{
+    newInterval = juce::jmax(0, newInterval);
+    // duplicating every interval-th sample plays interval source samples in interval + 1 output samples
+    speed.store(newInterval > 0 ? (double) newInterval / (newInterval + 1) : 1.0);
+    interval.store(newInterval);
+}
+
+int SlowAudioSource::getInterval() const
+{
+    return interval.load();
+}
+
+void SlowAudioSource::setSlowAmount(double percent)
+{
+    speed.store(getSpeedForSlowAmount(percent));
+    interval.store(getIntervalForSlowAmount(percent));
+}
+
+void SlowAudioSource::setQuality(int newQuality)
+{
+    jassert(newQuality >= Duplicate && newQuality <= KeepPitch);
+    quality.store(newQuality);
+}
+
+int SlowAudioSource::getQuality() const
+{
+    return quality.load();
+}
+
+//==============================================================================
+void SlowAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // slowing never needs more source samples than output samples
+    sourceBuffer.setSize(numInputChannels, samplesPerBlockExpected, false, false, true);
+    carryBuffer.setSize(numInputChannels, 1, false, true, true);
+    // interpolating never reads more than one source sample per output sample, plus the samples around them,
+    // and stretching reads a frame plus up to one hop at a time.
+    // The history is kept, because seekSource() may have already been called
+    int historyNeeded = juce::jmax(samplesPerBlockExpected + Resampler::samplesBefore + Resampler::samplesAfter + 1,
+                                   TimeStretcher::fftSize + TimeStretcher::hopSize);
+    historyBuffer.setSize(numInputChannels, juce::jmax(historyNeeded, historyBuffer.getNumSamples()), true, true, true);
+
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void SlowAudioSource::releaseResources()
+{
+    input->releaseResources();
+}
+
+void SlowAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numOutputChannels = bufferToFill.buffer->getNumChannels();
+    // only the channels the input actually has are slowed, and copied to the rest of the output at the end
+    const int numChannels = juce::jmin(numInputChannels, numOutputChannels);
+
+    // a new quality carries on from the place in the source the old one had reached
+    const int newQuality = quality.load();
+    if (newQuality != activeQuality) {
+        double position = activeQuality == Duplicate ? (double) sourcePos : interpolatePos;
+        activeQuality = newQuality;
+
+        if (activeQuality == Duplicate) {
+            setNextReadPosition(getDestIndex((juce::int64) position, interval.load()));
+        } else {
+            seekSource(position);
+        }
+    }
+
+    if (activeQuality == Duplicate) {
+        duplicateSamples(bufferToFill, numChannels);
+    } else if (activeQuality == KeepPitch) {
+        stretchSamples(bufferToFill, numChannels);
+    } else {
+        interpolateSamples(bufferToFill, numChannels);
+    }
+
+    // fan the slowed channels out to any output channels the input doesn't have
+    for (int channel = numChannels; channel < numOutputChannels; channel++) {
+        bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample, *bufferToFill.buffer, channel % numChannels,
+                                      bufferToFill.startSample, bufferToFill.numSamples);
+    }
+}
+
+void SlowAudioSource::duplicateSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels)
+{
+    const int currentInterval = interval.load();
+
+    // if the interval changed since the last block, the sample we were in the middle of duplicating
+    // might not be duplicated anymore
+    if (repeatPending && (currentInterval == 0 || (sourcePos - 1) % currentInterval != 0)) {
+        repeatPending = false;
+    }
+    if (skipRepeat && (currentInterval == 0 || sourcePos % currentInterval != 0)) {
+        skipRepeat = false;
+    }
+
+    // work out how many source samples are needed to fill this block
+    juce::int64 outputStart = getOutputPosition(currentInterval);
+    juce::int64 lastSourceIX = getSourceIndex(outputStart + bufferToFill.numSamples - 1, currentInterval);
+    int numSourceSamples = (int) juce::jmax((juce::int64) 0, lastSourceIX - sourcePos + 1);
+
+    if (sourceBuffer.getNumSamples() < numSourceSamples) {
+        sourceBuffer.setSize(numInputChannels, numSourceSamples, false, false, true);
+    }
+
+    if (numSourceSamples > 0) {
+        juce::AudioSourceChannelInfo sourceInfo(&sourceBuffer, 0, numSourceSamples);
+        input->getNextAudioBlock(sourceInfo);
+        foldSourceChannels(sourceBuffer, bufferToFill.buffer->getNumChannels(), 0, numSourceSamples);
+    }
+
+    juce::AudioBuffer<float>& dest = *bufferToFill.buffer;
+    const int startSample = bufferToFill.startSample;
+    int destIX = 0;
+    int sourceIX = 0;
+
+    // write the duplicate left over from the previous block
+    if (repeatPending && bufferToFill.numSamples > 0) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            dest.setSample(channel, startSample, carryBuffer.getSample(channel, 0));
+        }
+        repeatPending = false;
+        destIX++;
+    }
+
+    while (destIX < bufferToFill.numSamples)
+    {
+        // if sourcePos is a multiple of the interval: the sample is written twice
+        if (currentInterval > 0 && sourcePos % currentInterval == 0 && !skipRepeat) {
+            for (int channel = 0; channel < numChannels; channel++)
+            {
+                float sample = sourceBuffer.getSample(channel, sourceIX);
+                dest.setSample(channel, startSample + destIX, sample);
+
+                if (destIX + 1 < bufferToFill.numSamples) {
+                    dest.setSample(channel, startSample + destIX + 1, sample);
+                } else {
+                    // the block is full, so the duplicate starts the next block
+                    carryBuffer.setSample(channel, 0, sample);
+                }
+            }
+
+            repeatPending = destIX + 1 >= bufferToFill.numSamples;
+            destIX += repeatPending ? 1 : 2;
+            sourceIX++;
+            sourcePos++;
+            continue;
+        }
+        skipRepeat = false;
+
+        // every sample up to the next multiple of the interval is copied once, so copy the whole run
+        juce::int64 samplesToNextRepeat = currentInterval > 0 ? currentInterval - sourcePos % currentInterval
+                                                              : bufferToFill.numSamples;
+        int runLength = (int) juce::jmin(samplesToNextRepeat, (juce::int64) (bufferToFill.numSamples - destIX));
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            juce::FloatVectorOperations::copy(dest.getWritePointer(channel, startSample + destIX),
+                                              sourceBuffer.getReadPointer(channel, sourceIX), runLength);
+        }
+
+        destIX += runLength;
+        sourceIX += runLength;
+        sourcePos += runLength;
+    }
+
+    jassert(sourceIX == numSourceSamples);
+}
+
+void SlowAudioSource::interpolateSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels)
+{
+    const int numSamples = bufferToFill.numSamples;
+
+    // a new speed is ramped to one sample at a time across the block
+    const double startSpeed = playbackSpeed;
+    const double speedIncrement = numSamples > 0 ? (speed.load() - startSpeed) / numSamples : 0.0;
+
+    // read every source sample up to the last one the kernel needs for the last output sample
+    double lastPosition = Resampler::getPosition(interpolatePos, startSpeed, speedIncrement, numSamples - 1);
+    readHistory((juce::int64) lastPosition + Resampler::samplesAfter + 1, bufferToFill.buffer->getNumChannels());
+
+    double position = interpolatePos - (double) historyStart;
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const float* in = historyBuffer.getReadPointer(channel);
+        float* out = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
+
+        if (activeQuality == Linear) {
+            Resampler::processLinear(in, position, startSpeed, out, numSamples, speedIncrement);
+        } else if (activeQuality == CubicHermite) {
+            Resampler::processCubic(in, position, startSpeed, out, numSamples, speedIncrement);
+        } else {
+            Resampler::processSinc(in, position, startSpeed, out, numSamples, speedIncrement);
+        }
+    }
+
+    interpolatePos = Resampler::getPosition(interpolatePos, startSpeed, speedIncrement, numSamples);
+    playbackSpeed = startSpeed + numSamples * speedIncrement;
+
+    // forget the samples before the ones the next block's kernel will need
+    discardHistory((juce::int64) interpolatePos - Resampler::samplesBefore);
+}
+
+void SlowAudioSource::stretchSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels)
+{
+    const int numSamples = bufferToFill.numSamples;
+    int done = 0;
+
+    // a new speed is ramped to across the block. Each frame moves on at the speed of the sample it starts at
+    const double startSpeed = playbackSpeed;
+    const double speedIncrement = numSamples > 0 ? (speed.load() - startSpeed) / numSamples : 0.0;
+
+    while (done < numSamples)
+    {
+        // the stretcher makes hopSize samples from each frame, however far through the source the frames are
+        if (stretcher.getNumReady() == 0) {
+            juce::int64 frameStart = (juce::int64) std::floor(frameCentre) - TimeStretcher::fftSize / 2;
+            readHistory(frameStart + TimeStretcher::fftSize, bufferToFill.buffer->getNumChannels());
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                framePointers[channel] = historyBuffer.getReadPointer(channel, (int) (frameStart - historyStart));
+            }
+            stretcher.processFrame(framePointers.data(), numChannels, (int) (frameStart - lastFrameStart));
+
+            lastFrameStart = frameStart;
+            frameCentre += TimeStretcher::hopSize * (startSpeed + done * speedIncrement);
+            discardHistory((juce::int64) std::floor(frameCentre) - TimeStretcher::fftSize / 2);
+        }
+
+        int numToRead = juce::jmin(stretcher.getNumReady(), numSamples - done);
+        stretcher.readOutput(*bufferToFill.buffer, bufferToFill.startSample + done, numToRead, numChannels);
+        done += numToRead;
+    }
+
+    interpolatePos = Resampler::getPosition(interpolatePos, startSpeed, speedIncrement, numSamples);
+    playbackSpeed = startSpeed + numSamples * speedIncrement;
+}
+
+void SlowAudioSource::seekSource(double sourcePosition)
+{
+    interpolatePos = sourcePosition;
+    playbackSpeed = speed.load();
+
+    if (activeQuality != KeepPitch) {
+        resetHistory((juce::int64) sourcePosition - Resampler::samplesBefore);
+        return;
+    }
+
+    // the first frames start before sourcePosition, so that the first sample played already has
+    // every frame that overlaps it added in. The centre of each frame lines up with the centre of
+    // the fftSize output samples it's added to
+    stretcher.reset();
+    frameCentre = sourcePosition + (TimeStretcher::hopSize - TimeStretcher::fftSize / 2) * speed.load();
+    lastFrameStart = (juce::int64) std::floor(frameCentre) - TimeStretcher::fftSize / 2;
+    resetHistory(lastFrameStart);
+}
+
+void SlowAudioSource::resetHistory(juce::int64 startIndex)
+{
+    historyStart = startIndex;
+
+    // samples before the start of the file are read as silence
+    juce::int64 readStart = juce::jmax((juce::int64) 0, historyStart);
+    historySize = (int) (readStart - historyStart);
+
+    if (historyBuffer.getNumSamples() < historySize) {
+        historyBuffer.setSize(numInputChannels, historySize, false, false, true);
+    }
+    historyBuffer.clear(0, historySize);
+
+    input->setNextReadPosition(readStart);
+}
+
+void SlowAudioSource::readHistory(juce::int64 endIndex, int numOutputChannels)
+{
+    int historyEnd = (int) (endIndex - historyStart);
+    if (historyEnd <= historySize) {
+        return;
+    }
+
+    if (historyBuffer.getNumSamples() < historyEnd) {
+        historyBuffer.setSize(numInputChannels, historyEnd, true, false, true);
+    }
+
+    juce::AudioSourceChannelInfo sourceInfo(&historyBuffer, historySize, historyEnd - historySize);
+    input->getNextAudioBlock(sourceInfo);
+    foldSourceChannels(historyBuffer, numOutputChannels, historySize, historyEnd - historySize);
+    historySize = historyEnd;
+}
+
+void SlowAudioSource::discardHistory(juce::int64 startIndex)
+{
+    int numUsed = (int) (startIndex - historyStart);
+    if (numUsed <= 0) {
+        return;
+    }
+    jassert(numUsed <= historySize);
+
+    for (int channel = 0; channel < numInputChannels; channel++)
+    {
+        float* samples = historyBuffer.getWritePointer(channel);
+        std::memmove(samples, samples + numUsed, sizeof(float) * (size_t) (historySize - numUsed));
+    }
+    historyStart += numUsed;
+    historySize -= numUsed;
+}
+
+void SlowAudioSource::foldSourceChannels(juce::AudioBuffer<float>& buffer, int numOutputChannels, int startSample, int numSamples)
+{
+    for (int channel = numOutputChannels; channel < numInputChannels; channel++) {
+        buffer.addFrom(channel % numOutputChannels, startSample, buffer, channel, startSample, numSamples);
+    }
+}
+
+void SlowAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    // newPosition is on the timeline of the quality that's been asked for, so switch to it now
+    activeQuality = quality.load();
+
+    if (activeQuality != Duplicate) {
+        seekSource(newPosition * speed.load());
+        return;
+    }
+
+    const int currentInterval = interval.load();
+
+    sourcePos = getSourceIndex(newPosition, currentInterval);
+    repeatPending = false;
+    // if newPosition lands on the duplicate of a sample, that sample should only be played once more
+    skipRepeat = currentInterval > 0 && newPosition == getDestIndex(sourcePos, currentInterval) + 1;
+
+    input->setNextReadPosition(sourcePos);
+}
+
+juce::int64 SlowAudioSource::getNextReadPosition() const
+{
+    if (activeQuality != Duplicate) {
+        return (juce::int64) std::llround(interpolatePos / speed.load());
+    }
+    return getOutputPosition(interval.load());
+}
+
+juce::int64 SlowAudioSource::getTotalLength() const
+{
+    if (activeQuality != Duplicate) {
+        return (juce::int64) std::ceil(input->getTotalLength() / speed.load());
+    }
+    return getDestIndex(input->getTotalLength(), interval.load());
+}
+
+bool SlowAudioSource::isLooping() const
+{
+    return false;
+}
+
+//==============================================================================
+void SlowAudioSource::render(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest, int interval, juce::ThreadPool* pool)
+{
+    if (interval <= 0) {
+        dest.makeCopyOf(source, true);
+        return;
+    }
+
+    const int numSourceSamples = source.getNumSamples();
+    dest.setSize(source.getNumChannels(), (int) getDestIndex(numSourceSamples, interval), false, false, false);
+
+    // not worth spreading across threads if each thread would only get a small piece
+    const int minSamplesPerJob = 65536;
+    int numJobs = pool != nullptr ? juce::jmin(pool->getNumThreads(), numSourceSamples / minSamplesPerJob) : 1;
+
+    if (numJobs <= 1) {
+        renderGroups(source, dest, interval, 0, numSourceSamples);
+        return;
+    }
+
+    // each source sample's destination only depends on its index, so the buffer can be split into
+    // chunks that are rendered independently. Chunks start on a multiple of interval so that no
+    // group is split between two jobs.
+    int numGroups = (numSourceSamples + interval - 1) / interval;
+    int groupsPerJob = (numGroups + numJobs - 1) / numJobs;
+    juce::int64 samplesPerJob = (juce::int64) groupsPerJob * interval;
+
+    std::atomic<int> jobsLeft(numJobs);
+    juce::WaitableEvent finished;
+
+    for (int job = 0; job < numJobs; job++)
+    {
+        int start = (int) juce::jmin((juce::int64) numSourceSamples, job * samplesPerJob);
+        int end = (int) juce::jmin((juce::int64) numSourceSamples, start + samplesPerJob);
+
+        pool->addJob([&source, &dest, interval, start, end, &jobsLeft, &finished]
+        {
+            renderGroups(source, dest, interval, start, end);
+
+            if (--jobsLeft == 0) {
+                finished.signal();
+            }
+        });
+    }
+
+    finished.wait();
+}
+
+void SlowAudioSource::renderGroups(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest,
+                                   int interval, int startSample, int endSample)
+{
+    for (int channel = 0; channel < source.getNumChannels(); channel++)
+    {
+        const float* in = source.getReadPointer(channel);
+        float* out = dest.getWritePointer(channel);
+
+        // each group of interval source samples is written as the first sample followed by the whole group
+        for (int groupStart = startSample; groupStart < endSample; groupStart += interval)
+        {
+            int destStart = (int) getDestIndex(groupStart, interval);
+            int groupLength = juce::jmin(interval, endSample - groupStart);
+
+            out[destStart] = in[groupStart];
+            juce::FloatVectorOperations::copy(out + destStart + 1, in + groupStart, groupLength);
+        }
+    }
+}
+
+juce::int64 SlowAudioSource::getDestIndex(juce::int64 sourceSampleNum, int interval)
+{
+    if (interval <= 0) {
+        return sourceSampleNum;
+    }
+
+    // every multiple of interval before sourceSampleNum has been duplicated once
+    juce::int64 samplesDuplicated = (sourceSampleNum + interval - 1) / interval;
+
+    return sourceSampleNum + samplesDuplicated;
+}
+
+juce::int64 SlowAudioSource::getSourceIndex(juce::int64 destSampleNum, int interval)
+{
+    if (interval <= 0) {
+        return destSampleNum;
+    }
+
+    // each group of interval source samples takes up interval+1 samples in the slowed audio,
+    // with the first sample of the group written twice
+    juce::int64 group = destSampleNum / (interval + 1);
+    juce::int64 offset = destSampleNum % (interval + 1);
+
+    if (offset <= 1) {
+        return group * interval;
+    }
+    return group * interval + offset - 1;
+}
+
+int SlowAudioSource::getIntervalForSlowAmount(double percent)
+{
+    // if percent is 0: the audio won't be slowed at all
+    if (percent <= 0) {
+        return 0;
+    }
+
+    return juce::jmax(1, (int) (100 / percent));
+}
+
+double SlowAudioSource::getSpeedForSlowAmount(double percent)
+{
+    return juce::jlimit(minSpeed, 1.0, 1.0 - percent / 100);
+}
+
+juce::int64 SlowAudioSource::getOutputPosition(int currentInterval) const
+{
+    if (currentInterval <= 0) {
+        return sourcePos;
+    }
+    if (repeatPending && (sourcePos - 1) % currentInterval == 0) {
+        return getDestIndex(sourcePos - 1, currentInterval) + 1;
+    }
+    if (skipRepeat && sourcePos % currentInterval == 0) {
+        return getDestIndex(sourcePos, currentInterval) + 1;
+    }
+    return getDestIndex(sourcePos, currentInterval);
+}
@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    SlowAudioSource.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "Resampler.h"
+#include "TimeStretcher.h"
+
+// This class slows down the audio it reads from another PositionableAudioSource
+// by duplicating every interval-th sample as the audio is streamed. Nothing is
+// rendered ahead of time, so a new interval takes effect on the next audio block.
+// Instead of duplicating samples, the audio can also be interpolated at any speed by one of the
+// Resampler kernels, which sounds cleaner (no repeated samples aliasing) at a higher CPU cost,
+// or time-stretched by a TimeStretcher, which slows the tempo without lowering the pitch.
+// Those qualities ramp to a new speed across the next audio block, so it doesn't change with a step.
+// Only as many channels as the input has are slowed: a mono input is slowed once and copied to
+// every output channel, and an input with more channels than the output is folded down first.
+
+class SlowAudioSource : public juce::PositionableAudioSource
+{
+public:
+    enum Quality
+    {
+        Duplicate = 1, // every interval-th sample is played twice
+        Linear,
+        CubicHermite,
+        WindowedSinc,
+        KeepPitch // time-stretched, so only the tempo changes
+    };
+
+    static constexpr double minSpeed = 0.5; // the slowest any quality plays, the same as duplicating every sample
+
+    /**
+     *@brief Creates a SlowAudioSource that reads from another source.
+     *@param inputSource  the source to read the unslowed audio from
+     *@param deleteInputWhenDeleted  if true, inputSource will be deleted when this object is deleted
+     *@param numInputChannels  the number of channels inputSource has
+     */
+    SlowAudioSource(juce::PositionableAudioSource* inputSource, bool deleteInputWhenDeleted, int numInputChannels);
+    ~SlowAudioSource() override;
+
+    /**
+     *@brief Sets the interval between duplicated samples.
+     *Can be called from any thread; the audio thread picks up the new value at the start of its next block.
+     *@param newInterval  if every 5th sample should be duplicated, newInterval should be set to 5. 0 disables slowing.
+     */
+    void setInterval(int newInterval);
+    int getInterval() const;
+
+    /**
+     *@brief Sets how much to slow the audio by.
+     *Duplicate uses the nearest interval, and the other qualities play at exactly the matching speed.
+     *Can be called from any thread, like setInterval().
+     *@param percent  the percentage to slow the audio by. 0 disables slowing.
+     */
+    void setSlowAmount(double percent);
+
+    /**
+     *@brief Sets how the audio is slowed.
+     *Can be called from any thread; the audio thread switches over at the start of its next block,
+     *carrying on from the same place in the source.
+     *@param newQuality  one of the Quality values
+     */
+    void setQuality(int newQuality);
+    int getQuality() const;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    //==============================================================================
+    /**
+     *@brief Slows a whole buffer at once.
+     *Produces exactly the same samples as playing the buffer through a SlowAudioSource, for when
+     *the slowed audio is needed up front (e.g. when exporting).
+     *@param source  the audio to slow
+     *@param dest  resized to hold the slowed audio and filled with it
+     *@param interval  the interval between samples to be duplicated (0 means no samples are duplicated)
+     *@param pool  if not nullptr, the buffer is split into chunks that are rendered in parallel on this pool.
+     *             Blocks until every chunk is done, so it mustn't be called from one of the pool's own jobs.
+     */
+    static void render(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest, int interval,
+                       juce::ThreadPool* pool = nullptr);
+
+    /**
+     *@brief Calculates the destination index based on the source index and interval of duplicated samples.
+     *@param sourceSampleNum  the index of the sample in the source
+     *@param interval  the interval between samples to be duplicated (0 means no samples are duplicated)
+     *@return  the index in the slowed audio where the sample is first written
+     */
+    static juce::int64 getDestIndex(juce::int64 sourceSampleNum, int interval);
+
+    /**
+     *@brief Calculates which source sample is played at an index of the slowed audio.
+     *@param destSampleNum  the index in the slowed audio
+     *@param interval  the interval between samples to be duplicated (0 means no samples are duplicated)
+     *@return  the index of the source sample
+     */
+    static juce::int64 getSourceIndex(juce::int64 destSampleNum, int interval);
+
+    /**
+     *@brief Calculates the interval between duplicated samples for a slow amount.
+     *@param percent  the percentage to slow the audio by
+     *@return  the interval, or 0 if percent is 0 and the audio shouldn't be slowed
+     */
+    static int getIntervalForSlowAmount(double percent);
+
+    /**
+     *@brief Calculates how far through the source each output sample moves on for a slow amount.
+     *@param percent  the percentage to slow the audio by
+     *@return  the speed, from minSpeed to 1
+     */
+    static double getSpeedForSlowAmount(double percent);
+
+private:
+    juce::OptionalScopedPointer<juce::PositionableAudioSource> input;
+    std::atomic<int> interval;
+    std::atomic<double> speed; // source samples per output sample, for every quality except Duplicate
+    std::atomic<int> quality;
+    const int numInputChannels;
+    int activeQuality; // the quality the audio thread is using
+
+    juce::int64 sourcePos; // index of the next source sample to be read from input
+    bool skipRepeat; // true if the sample at sourcePos has already been played once and shouldn't be duplicated
+    bool repeatPending; // true if the sample before sourcePos still needs to be duplicated
+
+    juce::AudioBuffer<float> sourceBuffer; // holds the source samples read for the current block
+    juce::AudioBuffer<float> carryBuffer; // holds the sample to be duplicated at the start of the next block
+
+    double interpolatePos; // position in the source of the next output sample, when not duplicating
+    double playbackSpeed; // the speed the last block ramped to, when not duplicating
+    juce::int64 historyStart; // index in the source of the first sample in historyBuffer
+    int historySize; // number of source samples held in historyBuffer
+    juce::AudioBuffer<float> historyBuffer; // the source samples the interpolator or stretcher still needs to read
+
+    TimeStretcher stretcher;
+    double frameCentre; // position in the source of the centre of the stretcher's next frame
+    juce::int64 lastFrameStart; // index in the source of the start of the stretcher's last frame
+    std::vector<const float*> framePointers;
+
+    /**
+     *@brief Fills the block by duplicating every interval-th sample.
+     */
+    void duplicateSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels);
+
+    /**
+     *@brief Fills the block by interpolating the source at speed with the active quality's kernel.
+     */
+    void interpolateSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels);
+
+    /**
+     *@brief Fills the block from the time-stretched source.
+     */
+    void stretchSamples(const juce::AudioSourceChannelInfo& bufferToFill, int numChannels);
+
+    /**
+     *@brief Starts interpolating or stretching from a position in the source, reading it from input again.
+     */
+    void seekSource(double sourcePosition);
+
+    /**
+     *@brief Empties historyBuffer and starts reading input into it from startIndex.
+     */
+    void resetHistory(juce::int64 startIndex);
+
+    /**
+     *@brief Reads input into historyBuffer until it holds every source sample before endIndex.
+     */
+    void readHistory(juce::int64 endIndex, int numOutputChannels);
+
+    /**
+     *@brief Removes the source samples before startIndex from historyBuffer.
+     */
+    void discardHistory(juce::int64 startIndex);
+
+    /**
+     *@brief Adds the source channels that the output has no room for onto the output's channels.
+     */
+    void foldSourceChannels(juce::AudioBuffer<float>& buffer, int numOutputChannels, int startSample, int numSamples);
+
+    /**
+     *@brief Renders the groups of source samples from startSample to endSample into dest.
+     *startSample must be a multiple of interval.
+     */
+    static void renderGroups(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest,
+                             int interval, int startSample, int endSample);
+
+    /**
+     *@brief Returns the position in the slowed audio that the next block will start at.
+     */
+    juce::int64 getOutputPosition(int currentInterval) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SlowAudioSource)
+};
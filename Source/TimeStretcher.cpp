@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    TimeStretcher.cpp
+
+  ==============================================================================
+*/
+
+#include "TimeStretcher.h"
+#include <cmath>
+
+static inline float wrapPhase(float x)
+{
+    const float twoPi = juce::MathConstants<float>::twoPi;
+    return x - twoPi * std::round(x / twoPi);
+}
+
+TimeStretcher::TimeStretcher(int channels)
+    : maxChannels(juce::jmax(1, channels)), fft(fftSize), window(fftSize), spectrum(fftSize), bins(2 * numBins),
+      magnitude(numBins), phase(numBins), rotation(numBins), lastPhase((size_t) (maxChannels * numBins)),
+      outputPhase((size_t) (maxChannels * numBins)), overlap((size_t) (maxChannels * fftSize)),
+      ready((size_t) (maxChannels * hopSize))
+{
+    // a periodic Hann window, applied before and after the FFT. The squared windows of frames
+    // hopSize apart add up to 1.5, so it's scaled to add up to 1 instead
+    const float scale = 1.0f / std::sqrt(1.5f);
+    for (int n = 0; n < fftSize; n++)
+    {
+        window[n] = scale * (0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * n / fftSize));
+    }
+
+    reset();
+}
+
+TimeStretcher::~TimeStretcher()
+{
+}
+
+void TimeStretcher::reset()
+{
+    std::fill(overlap.begin(), overlap.end(), 0.0f);
+    firstFrame = true;
+    framesToDiscard = fftSize / hopSize - 1;
+    readyStart = 0;
+    numReady = 0;
+}
+
+void TimeStretcher::processFrame(const float* const* frame, int numChannels, int analysisHop)
+{
+    jassert(numReady == 0 && numChannels <= maxChannels);
+
+    for (int first = 0; first < numChannels; first += 2)
+    {
+        const bool pair = first + 1 < numChannels;
+
+        for (int n = 0; n < fftSize; n++)
+        {
+            spectrum[n] = std::complex<float>(window[n] * frame[first][n], pair ? window[n] * frame[first + 1][n] : 0.0f);
+        }
+        fft.perform(spectrum.data(), false);
+
+        // the spectrum of a real signal is conjugate-symmetric, so the two channels can be separated as
+        // X1[k] = (Z[k] + conj(Z[N - k])) / 2 and X2[k] = (Z[k] - conj(Z[N - k])) / 2i
+        std::complex<float>* bins1 = bins.data();
+        std::complex<float>* bins2 = bins.data() + numBins;
+        for (int k = 0; k < numBins; k++)
+        {
+            const std::complex<float> z = spectrum[k];
+            const std::complex<float> mirror = std::conj(spectrum[(fftSize - k) % fftSize]);
+            bins1[k] = 0.5f * (z + mirror);
+            bins2[k] = std::complex<float>(0.0f, -0.5f) * (z - mirror);
+        }
+
+        stretchBins(first, bins1, analysisHop);
+        if (pair) {
+            stretchBins(first + 1, bins2, analysisHop);
+        }
+
+        // put the channels back together as Z[k] = Y1[k] + i Y2[k], with the top half mirrored
+        const std::complex<float> i(0.0f, 1.0f);
+        for (int k = 0; k < numBins; k++)
+        {
+            const std::complex<float> y1 = bins1[k];
+            const std::complex<float> y2 = pair ? bins2[k] : std::complex<float>();
+            spectrum[k] = y1 + i * y2;
+            if (k > 0 && k < numBins - 1) {
+                spectrum[fftSize - k] = std::conj(y1) + i * std::conj(y2);
+            }
+        }
+
+        fft.perform(spectrum.data(), true);
+
+        float* out1 = overlap.data() + first * fftSize;
+        float* out2 = pair ? out1 + fftSize : nullptr;
+        for (int n = 0; n < fftSize; n++)
+        {
+            out1[n] += window[n] * spectrum[n].real();
+            if (pair) {
+                out2[n] += window[n] * spectrum[n].imag();
+            }
+        }
+    }
+
+    firstFrame = false;
+
+    // the first hopSize samples of the overlap have had every frame that covers them added now
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        float* channelOverlap = overlap.data() + channel * fftSize;
+
+        if (framesToDiscard == 0) {
+            std::copy(channelOverlap, channelOverlap + hopSize, ready.data() + channel * hopSize);
+        }
+        std::copy(channelOverlap + hopSize, channelOverlap + fftSize, channelOverlap);
+        std::fill(channelOverlap + fftSize - hopSize, channelOverlap + fftSize, 0.0f);
+    }
+
+    if (framesToDiscard > 0) {
+        framesToDiscard--;
+        return;
+    }
+    readyStart = 0;
+    numReady = hopSize;
+}
+
+int TimeStretcher::getNumReady() const
+{
+    return numReady;
+}
+
+void TimeStretcher::readOutput(juce::AudioBuffer<float>& dest, int startSample, int numSamples, int numChannels)
+{
+    jassert(numSamples <= numReady);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        dest.copyFrom(channel, startSample, ready.data() + channel * hopSize + readyStart, numSamples);
+    }
+
+    readyStart += numSamples;
+    numReady -= numSamples;
+}
+
+void TimeStretcher::stretchBins(int channel, std::complex<float>* channelBins, int analysisHop)
+{
+    float* previousPhase = lastPhase.data() + channel * numBins;
+    float* previousOutput = outputPhase.data() + channel * numBins;
+
+    for (int k = 0; k < numBins; k++)
+    {
+        magnitude[k] = std::abs(channelBins[k]);
+        phase[k] = std::arg(channelBins[k]);
+    }
+
+    if (firstFrame) {
+        // nothing to carry on from, so the frame is written as it is
+        std::copy(phase.begin(), phase.end(), previousPhase);
+        std::copy(phase.begin(), phase.end(), previousOutput);
+        return;
+    }
+
+    // find the peaks, and work out how far each one's phase moves over hopSize output samples
+    // from its true frequency over the analysisHop samples since the last frame
+    const float binFrequency = juce::MathConstants<float>::twoPi / fftSize;
+    int lastPeak = -1;
+    int regionStart = 0;
+
+    for (int k = 1; k < numBins - 1; k++)
+    {
+        if (magnitude[k] <= magnitude[k - 1] || magnitude[k] < magnitude[k + 1]) {
+            continue;
+        }
+
+        const float expected = binFrequency * k * analysisHop;
+        const float deviation = wrapPhase(phase[k] - previousPhase[k] - expected);
+        const float frequency = binFrequency * k + deviation / analysisHop;
+        const float newPhase = previousOutput[k] + frequency * hopSize;
+        rotation[k] = newPhase - phase[k];
+
+        // the bins between this peak and the last one go with whichever peak is closer
+        int regionEnd = lastPeak < 0 ? k : (lastPeak + k + 1) / 2;
+        for (int bin = regionStart; bin < regionEnd; bin++)
+        {
+            rotation[bin] = lastPeak < 0 ? rotation[k] : rotation[lastPeak];
+        }
+        regionStart = regionEnd;
+        lastPeak = k;
+    }
+
+    for (int bin = regionStart; bin < numBins; bin++)
+    {
+        rotation[bin] = lastPeak < 0 ? 0.0f : rotation[lastPeak];
+    }
+
+    std::copy(phase.begin(), phase.end(), previousPhase);
+
+    // DC and Nyquist must stay real, so they're left as they are
+    previousOutput[0] = phase[0];
+    previousOutput[numBins - 1] = phase[numBins - 1];
+    for (int k = 1; k < numBins - 1; k++)
+    {
+        previousOutput[k] = wrapPhase(phase[k] + rotation[k]);
+        channelBins[k] = std::polar(magnitude[k], previousOutput[k]);
+    }
+}
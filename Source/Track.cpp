@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    Track.cpp
+
+  ==============================================================================
+*/
+
+#include "Track.h"
+
+Track::Track(juce::File trackFile)
+    : file(trackFile), buffer(std::make_shared<juce::AudioBuffer<float>>()), cache(nullptr), decodingSource(nullptr), decodeThread(nullptr),
+      numSamplesDecoded(0), loaded(false), cancelled(false), bpm(0.0f)
+{
+}
+
+Track::~Track()
+{
+    // stop decoding in the background before the reader and buffer are deleted
+    if (decodeThread != nullptr) {
+        decodeThread->removeTimeSliceClient(this);
+    }
+    if (decodingSource != nullptr && cache != nullptr && !isFullyDecoded()) {
+        cache->cancelDecoding(file);
+    }
+    // slowSource may be reading from reader, so delete it first
+    slowSource.reset();
+    reader.reset();
+}
+
+bool Track::load(juce::AudioFormatManager& formatManager, int loadMode, juce::TimeSliceThread& readAheadThread,
+                 DecodedAudioCache* decodedCache)
+{
+    juce::PositionableAudioSource* input = nullptr;
+    cache = decodedCache;
+
+    if (loadMode == DecodeToMemory && cache != nullptr) {
+        // if the file was decoded recently, its audio can be played straight from the cache
+        if (auto cachedBuffer = cache->get(file)) {
+            buffer = cachedBuffer;
+            numSamplesDecoded.store(buffer->getNumSamples());
+            input = new juce::MemoryAudioSource(*buffer, false);
+        }
+    }
+
+    if (loadMode == MemoryMapped) {
+        // wav and aiff data can be read straight out of the mapped file, converting each block to float
+        // as it's played, so the OS page cache does all of the file I/O
+        juce::AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader(format != nullptr ? format->createMemoryMappedReader(file) : nullptr);
+
+        if (mappedReader != nullptr && mappedReader->mapEntireFile()) {
+            reader.reset(mappedReader.release());
+            input = new juce::AudioFormatReaderSource(reader.get(), false);
+        }
+    }
+
+    if (input == nullptr) {
+        reader.reset(formatManager.createReaderFor(file));
+
+        if (reader == nullptr) {
+            loadFinished.signal();
+            return false;
+        }
+
+        if (loadMode == StreamFromDisk) {
+            // only readAheadSamples are decoded at a time, and playback can start after the first chunk
+            input = new juce::BufferingAudioSource(new juce::AudioFormatReaderSource(reader.get(), false),
+                                                   readAheadThread, true, readAheadSamples, (int) reader->numChannels);
+        } else {
+            // allocate space in buffer and only decode the start of the file now, so playback can
+            // start straight away. The rest is decoded on readAheadThread while the track plays.
+            // a mono file is kept as one channel, and only copied to both speakers as it's played
+            buffer->setSize((int) reader->numChannels, (int) reader->lengthInSamples, false, true, false);
+
+            // anything else that needs the file's audio, like BPM detection, can wait for it to be added to
+            // the cache rather than decoding it again
+            if (cache != nullptr && !isFullyDecoded()) {
+                cache->startDecoding(file);
+            }
+
+            while (numSamplesDecoded.load() < juce::jmin(initialDecodeSamples, buffer->getNumSamples()))
+            {
+                if (cancelled.load()) {
+                    if (cache != nullptr) {
+                        cache->cancelDecoding(file);
+                    }
+                    loadFinished.signal();
+                    return false;
+                }
+                decodeNextChunk();
+            }
+
+            // the decoder and the audio thread share buffer, so it's only played up to the samples the
+            // decoder has finished. Past them (after a seek, or if the decoder falls behind), the file is
+            // streamed through a second reader until the decoder catches up. A file that has already been
+            // decoded completely doesn't need one
+            juce::PositionableAudioSource* fallback = nullptr;
+            if (!isFullyDecoded()) {
+                if (auto* streamReader = formatManager.createReaderFor(file)) {
+                    fallback = new juce::BufferingAudioSource(new juce::AudioFormatReaderSource(streamReader, true),
+                                                              readAheadThread, true, readAheadSamples, (int) streamReader->numChannels);
+                }
+            }
+            decodingSource = new DecodingAudioSource(*buffer, numSamplesDecoded, fallback);
+            input = decodingSource;
+        }
+    }
+
+    // slowSource streams the data from input, duplicating samples as it goes. There's only no reader
+    // when the decoded audio came from the cache
+    int numChannels = reader != nullptr ? (int) reader->numChannels : buffer->getNumChannels();
+    slowSource.reset(new SlowAudioSource(input, true, numChannels));
+
+    if (!isFullyDecoded()) {
+        decodeThread = &readAheadThread;
+        decodeThread->addTimeSliceClient(this);
+    }
+
+    loaded.store(true);
+    loadFinished.signal();
+    return true;
+}
+
+void Track::cancelLoading()
+{
+    cancelled.store(true);
+}
+
+bool Track::hasFinishedLoading() const
+{
+    return loadFinished.wait(0);
+}
+
+bool Track::hasFailedToLoad() const
+{
+    return hasFinishedLoading() && !isLoaded();
+}
+
+bool Track::isLoaded() const
+{
+    return loaded.load();
+}
+
+bool Track::isFullyDecoded() const
+{
+    return numSamplesDecoded.load() >= buffer->getNumSamples();
+}
+
+int Track::useTimeSlice()
+{
+    if (cancelled.load() || isFullyDecoded()) {
+        return -1;
+    }
+
+    decodeNextChunk();
+
+    // keep going straight away until the whole file is decoded. After that, the second reader and its
+    // read-ahead buffer are just using memory. This is called on the thread that fills that buffer,
+    // which can remove it from itself
+    if (isFullyDecoded()) {
+        decodingSource->releaseFallback();
+        return -1;
+    }
+    return 0;
+}
+
+void Track::decodeNextChunk()
+{
+    int start = numSamplesDecoded.load();
+    int numToRead = juce::jmin(decodeChunkSamples, buffer->getNumSamples() - start);
+
+    reader->read(buffer.get(), start, numToRead, start, true, true);
+    // publishes the new samples to the DecodingAudioSource on the audio thread
+    numSamplesDecoded.store(start + numToRead, std::memory_order_release);
+
+    // the buffer won't be written to again, so it can be shared with other Tracks
+    if (isFullyDecoded() && cache != nullptr) {
+        cache->add(file, buffer);
+    }
+}
+
+juce::File Track::getFile() const
+{
+    return file;
+}
+
+SlowAudioSource* Track::getSlowSource() const
+{
+    return slowSource.get();
+}
+
+const juce::AudioBuffer<float>& Track::getBuffer() const
+{
+    return *buffer;
+}
+
+bool Track::hasBpm() const
+{
+    return bpm.load() > 0.0f;
+}
+
+float Track::getBpm() const
+{
+    return bpm.load();
+}
+
+void Track::setBpm(float newBpm)
+{
+    bpm.store(newBpm);
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    Track.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "SlowAudioSource.h"
+#include "DecodedAudioCache.h"
+#include "DecodingAudioSource.h"
+
+// This class holds everything needed to play one file from the queue: the reader, the decoded
+// audio (if it was read into memory) and the SlowAudioSource that plays it. A Track can be loaded
+// on a background thread, so the next file in the queue is ready before the current one finishes.
+// When a file is decoded into memory, only the start is decoded before it can be played, and the
+// rest is decoded in the background as a TimeSliceClient, while a DecodingAudioSource plays the
+// part that's been decoded and streams the rest from the file. The stream is closed as soon as the
+// whole file is decoded. Fully decoded files are kept in a DecodedAudioCache, so a file that is
+// queued again doesn't have to be decoded again.
+
+class Track : private juce::TimeSliceClient
+{
+public:
+    enum LoadMode
+    {
+        DecodeToMemory = 1,
+        StreamFromDisk,
+        MemoryMapped
+    };
+
+    static constexpr int readAheadSamples = 65536; // size of the buffer that is kept filled when streaming from disk
+    static constexpr int decodeChunkSamples = 65536; // number of samples decoded at a time when decoding to memory
+    static constexpr int initialDecodeSamples = 4 * decodeChunkSamples; // number of samples decoded before the track can play
+
+    Track(juce::File trackFile);
+    ~Track();
+
+    /**
+     *@brief Opens the file and creates the slowSource that plays it.
+     *Depending on loadMode, the file is either decoded into buffer, streamed from disk through a
+     *fixed-size buffer that readAheadThread keeps filled, or memory-mapped and read in place.
+     *If the file can't be memory-mapped, it is read into buffer instead. Safe to call from a background thread.
+     *@param formatManager  the format manager used to create the reader
+     *@param loadMode  one of the LoadMode values
+     *@param readAheadThread  the thread that fills the buffer when streaming from disk
+     *@param cache  if not nullptr, decoded audio is taken from this cache when the file is in it, and added to it
+     *              once the whole file has been decoded. Must outlive the Track.
+     *@return  true if the file was loaded, false if it couldn't be read or loading was cancelled
+     */
+    bool load(juce::AudioFormatManager& formatManager, int loadMode, juce::TimeSliceThread& readAheadThread,
+              DecodedAudioCache* cache = nullptr);
+
+    /**
+     *@brief Makes a call to load() on another thread return early.
+     */
+    void cancelLoading();
+
+    /**
+     *@brief Returns true once load() has returned, whether or not the file was loaded. Never blocks.
+     */
+    bool hasFinishedLoading() const;
+
+    /**
+     *@brief Returns true once load() has returned without loading the file, e.g. because it couldn't be read. Never blocks.
+     */
+    bool hasFailedToLoad() const;
+
+    bool isLoaded() const;
+
+    /**
+     *@brief Returns true once every sample of the file has been decoded into buffer.
+     *Always true if the file is streamed or memory-mapped instead.
+     */
+    bool isFullyDecoded() const;
+
+    juce::File getFile() const;
+    SlowAudioSource* getSlowSource() const;
+
+    /**
+     *@brief Returns the audio decoded into memory (empty if the file is streamed or memory-mapped).
+     *It's still being written until isFullyDecoded() returns true, so it mustn't be read before then.
+     */
+    const juce::AudioBuffer<float>& getBuffer() const;
+
+    /**
+     *@brief Returns true if the BPM of this track has been detected.
+     */
+    bool hasBpm() const;
+    float getBpm() const;
+    void setBpm(float newBpm);
+
+private:
+    juce::File file;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    std::shared_ptr<juce::AudioBuffer<float>> buffer; // holds the audio when the whole file is read into memory. Shared with cache
+    DecodedAudioCache* cache;
+    std::unique_ptr<SlowAudioSource> slowSource;
+    DecodingAudioSource* decodingSource; // plays buffer while it's being decoded, if it was. Owned by slowSource
+    juce::TimeSliceThread* decodeThread; // the thread decoding the rest of the file, if there's any left
+    std::atomic<int> numSamplesDecoded;
+
+    std::atomic<bool> loaded;
+    std::atomic<bool> cancelled;
+    std::atomic<float> bpm; // 0 until the BPM has been detected
+    juce::WaitableEvent loadFinished{true};
+
+    /**
+     *@brief Decodes the next chunk of the file into buffer, and closes decodingSource's stream once it's
+     *all decoded. Called on readAheadThread.
+     *@return  the number of milliseconds until it should be called again, or -1 once the whole file is decoded
+     */
+    int useTimeSlice() override;
+
+    /**
+     *@brief Decodes the next decodeChunkSamples samples of the file into buffer.
+     */
+    void decodeNextChunk();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Track)
+};
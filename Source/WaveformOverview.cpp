@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    WaveformOverview.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformOverview.h"
+
+WaveformOverview::WaveformOverview(juce::AudioFormatManager& manager, DecodedAudioCache& cache, std::function<double()> playheadGetter)
+    : formatManager(manager), decodedCache(cache), getPlayhead(std::move(playheadGetter)), paintedSamplesDone(-1), paintedPlayheadX(-1)
+{
+    startTimerHz(refreshHz);
+}
+
+WaveformOverview::~WaveformOverview()
+{
+    stopTimer();
+    if (cancelBuild != nullptr) {
+        cancelBuild->store(true);
+    }
+    buildPool.removeAllJobs(true, 10000);
+}
+
+void WaveformOverview::setFile(const juce::File& newFile)
+{
+    if (newFile == file) {
+        return;
+    }
+
+    file = newFile;
+    peaks.reset();
+    if (cancelBuild != nullptr) {
+        cancelBuild->store(true);
+    }
+    cancelBuild.reset();
+    repaint();
+
+    if (file == juce::File()) {
+        return;
+    }
+
+    // the job keeps its own references, so it can finish safely after another file is set.
+    // The peaks are handed over as soon as they're allocated, and drawn as they fill in
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    cancelBuild = cancelled;
+    juce::Component::SafePointer<WaveformOverview> safeThis(this);
+    juce::File fileToBuild = file;
+
+    buildPool.addJob([this, safeThis, fileToBuild, cancelled]
+    {
+        WaveformPeaks::build(fileToBuild, formatManager, &decodedCache, *cancelled,
+                             [safeThis, fileToBuild, cancelled] (std::shared_ptr<WaveformPeaks> newPeaks)
+        {
+            juce::MessageManager::callAsync([safeThis, fileToBuild, cancelled, newPeaks]
+            {
+                if (safeThis != nullptr && !cancelled->load() && safeThis->file == fileToBuild) {
+                    safeThis->peaks = newPeaks;
+                    safeThis->repaint();
+                }
+            });
+        });
+    });
+}
+
+void WaveformOverview::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds();
+    g.setColour(grey);
+    g.drawRect(bounds);
+
+    paintedPlayheadX = getPlayheadX();
+    if (peaks == nullptr) {
+        paintedSamplesDone = -1;
+        return;
+    }
+
+    paintedSamplesDone = peaks->getNumSamplesDone();
+    const juce::int64 length = peaks->getLengthInSamples();
+    const int width = getWidth();
+    const float centre = getHeight() * 0.5f;
+    const float scale = getHeight() * 0.5f - 2.0f;
+
+    // one range of peaks per pixel, wherever the pixel's samples have been read
+    g.setColour(blackGrey);
+    auto clip = g.getClipBounds();
+    for (int x = juce::jmax(1, clip.getX()); x < juce::jmin(width - 1, clip.getRight()); x++)
+    {
+        float min, max;
+        juce::int64 start = length * x / width;
+        juce::int64 end = juce::jmax(start + 1, length * (x + 1) / width);
+        if (peaks->getRange(start, end, min, max)) {
+            g.drawVerticalLine(x, centre - max * scale, centre - min * scale + 1.0f);
+        }
+    }
+
+    if (paintedPlayheadX >= 0) {
+        g.setColour(newPink);
+        g.drawVerticalLine(paintedPlayheadX, 1.0f, getHeight() - 1.0f);
+    }
+}
+
+int WaveformOverview::getPlayheadX() const
+{
+    if (file == juce::File() || getPlayhead == nullptr) {
+        return -1;
+    }
+    return juce::roundToInt(juce::jlimit(0.0, 1.0, getPlayhead()) * (getWidth() - 1));
+}
+
+void WaveformOverview::timerCallback()
+{
+    juce::int64 samplesDone = peaks != nullptr ? peaks->getNumSamplesDone() : -1;
+    int playheadX = getPlayheadX();
+
+    if (samplesDone != paintedSamplesDone) {
+        repaint();
+    } else if (playheadX != paintedPlayheadX) {
+        // only the columns the playhead has left and moved to need painting again
+        repaint(juce::jmax(0, paintedPlayheadX), 0, 1, getHeight());
+        repaint(juce::jmax(0, playheadX), 0, 1, getHeight());
+        paintedPlayheadX = playheadX;
+    }
+}
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    WaveformOverview.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "WaveformPeaks.h"
+#include "DecodedAudioCache.h"
+
+// This class draws the waveform of the current track as a strip, with the playhead over it.
+// The track's WaveformPeaks are read from the cache or built on a background thread when the
+// file is set, and drawn as they're built, so the strip fills in from left to right while the
+// file loads. Each repaint looks up one range of peaks per pixel, so it costs the same for a
+// track of any length.
+
+class WaveformOverview : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int refreshHz = 30;
+
+    /**
+     *@param formatManager  used to read the files. Must outlive the WaveformOverview
+     *@param decodedCache  the peaks are built from a file's decoded audio if it's in here. Must outlive the WaveformOverview
+     *@param playheadGetter  returns how far through the track the playhead is, from 0 to 1
+     */
+    WaveformOverview(juce::AudioFormatManager& formatManager, DecodedAudioCache& decodedCache, std::function<double()> playheadGetter);
+    ~WaveformOverview() override;
+
+    /**
+     *@brief Shows the waveform of a file, starting to build its peaks if they aren't cached.
+     *Does nothing if the file is already shown.
+     *@param newFile  the file to show, or juce::File() to clear the strip
+     */
+    void setFile(const juce::File& newFile);
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    juce::AudioFormatManager& formatManager;
+    DecodedAudioCache& decodedCache;
+    std::function<double()> getPlayhead;
+
+    juce::File file;
+    std::shared_ptr<WaveformPeaks> peaks; // the peaks of file, once they've been allocated
+    std::shared_ptr<std::atomic<bool>> cancelBuild; // set to stop building the peaks of a file that's no longer shown
+    juce::ThreadPool buildPool{1};
+
+    juce::int64 paintedSamplesDone; // the progress of the peaks when they were last painted
+    int paintedPlayheadX;
+
+    juce::Colour grey = juce::Colour::fromFloatRGBA(0.42f, 0.42f, 0.42f, 1.0f);
+    juce::Colour blackGrey = juce::Colour::fromFloatRGBA(0.2f, 0.2f, 0.2f, 1.0f);
+    juce::Colour newPink = juce::Colour::fromRGB(239, 59, 243);
+
+    int getPlayheadX() const;
+
+    /**
+     *@brief Repaints if the peaks have grown or the playhead has moved a pixel.
+     */
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformOverview)
+};
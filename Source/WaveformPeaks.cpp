@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    WaveformPeaks.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformPeaks.h"
+
+static const int cacheMagic = 0x4b505253; // "SRPK"
+static const int cacheVersion = 1;
+
+WaveformPeaks::WaveformPeaks(juce::int64 lengthInSamples) : length(juce::jmax((juce::int64) 0, lengthInSamples)), numSamplesDone(0)
+{
+    levels.emplace_back((size_t) ((length + samplesPerPeak - 1) / samplesPerPeak));
+    while (levels.back().size() > 1)
+    {
+        levels.emplace_back((levels.back().size() + 1) / 2);
+    }
+}
+
+WaveformPeaks::~WaveformPeaks()
+{
+}
+
+std::shared_ptr<WaveformPeaks> WaveformPeaks::build(const juce::File& file, juce::AudioFormatManager& formatManager,
+                                                    DecodedAudioCache* decodedCache, const std::atomic<bool>& cancelled,
+                                                    const std::function<void(std::shared_ptr<WaveformPeaks>)>& onCreated)
+{
+    const juce::File cacheFile = getCacheFile(file);
+    if (auto cached = loadFromCache(cacheFile, file)) {
+        onCreated(cached);
+        return cached;
+    }
+
+    // if the file has already been decoded there's no need to read it again
+    std::shared_ptr<juce::AudioBuffer<float>> decoded = decodedCache != nullptr ? decodedCache->get(file) : nullptr;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::int64 lengthInSamples;
+
+    if (decoded != nullptr) {
+        lengthInSamples = decoded->getNumSamples();
+    } else {
+        reader.reset(formatManager.createReaderFor(file));
+        if (reader == nullptr) {
+            return nullptr;
+        }
+        lengthInSamples = reader->lengthInSamples;
+    }
+
+    auto peaks = std::make_shared<WaveformPeaks>(lengthInSamples);
+    onCreated(peaks);
+
+    juce::AudioBuffer<float> chunk(reader != nullptr ? (int) reader->numChannels : 0, reader != nullptr ? chunkSamples : 0);
+    for (juce::int64 pos = 0; pos < lengthInSamples; pos += chunkSamples)
+    {
+        if (cancelled.load()) {
+            return nullptr;
+        }
+
+        int numSamples = (int) juce::jmin((juce::int64) chunkSamples, lengthInSamples - pos);
+        if (decoded != nullptr) {
+            peaks->addSamples(*decoded, (int) pos, numSamples);
+        } else {
+            reader->read(&chunk, 0, numSamples, pos, true, true);
+            peaks->addSamples(chunk, 0, numSamples);
+        }
+    }
+
+    peaks->saveToCache(cacheFile, file);
+    return peaks;
+}
+
+void WaveformPeaks::addSamples(const juce::AudioBuffer<float>& source, int startSample, int numSamples)
+{
+    const juce::int64 previousDone = numSamplesDone.load(std::memory_order_relaxed);
+    const juce::int64 done = juce::jmin(length, previousDone + numSamples);
+    std::vector<Peak>& peaks = levels[0];
+
+    size_t index = (size_t) (previousDone / samplesPerPeak);
+    for (int i = 0; i < (int) (done - previousDone); i += samplesPerPeak)
+    {
+        int n = juce::jmin(samplesPerPeak, (int) (done - previousDone) - i);
+        float lowest = 0.0f;
+        float highest = 0.0f;
+
+        for (int channel = 0; channel < source.getNumChannels(); channel++)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(source.getReadPointer(channel, startSample + i), n);
+            lowest = juce::jmin(lowest, range.getStart());
+            highest = juce::jmax(highest, range.getEnd());
+        }
+
+        // rounded outwards, so quiet peaks don't disappear
+        peaks[index++] = { (juce::int8) juce::jlimit(-127, 127, (int) std::floor(lowest * 127.0f)),
+                           (juce::int8) juce::jlimit(-127, 127, (int) std::ceil(highest * 127.0f)) };
+    }
+
+    addUpperLevels(previousDone, done);
+    numSamplesDone.store(done, std::memory_order_release);
+}
+
+void WaveformPeaks::addUpperLevels(juce::int64 previousDone, juce::int64 done)
+{
+    for (size_t level = 1; level < levels.size(); level++)
+    {
+        const std::vector<Peak>& below = levels[level - 1];
+        std::vector<Peak>& peaks = levels[level];
+
+        juce::int64 end = getNumPeaksDone((int) level, done);
+        for (juce::int64 i = getNumPeaksDone((int) level, previousDone); i < end; i++)
+        {
+            Peak peak = below[(size_t) (2 * i)];
+            // the last peak of a level can cover just one peak of the level below
+            if ((size_t) (2 * i + 1) < below.size()) {
+                peak.min = juce::jmin(peak.min, below[(size_t) (2 * i + 1)].min);
+                peak.max = juce::jmax(peak.max, below[(size_t) (2 * i + 1)].max);
+            }
+            peaks[(size_t) i] = peak;
+        }
+    }
+}
+
+bool WaveformPeaks::getRange(juce::int64 startSample, juce::int64 endSample, float& min, float& max) const
+{
+    const juce::int64 done = numSamplesDone.load(std::memory_order_acquire);
+    const juce::int64 first = juce::jmax((juce::int64) 0, startSample) / samplesPerPeak;
+    const juce::int64 last = juce::jmin((endSample - 1) / samplesPerPeak, getNumPeaksDone(0, done) - 1);
+
+    if (endSample <= startSample || last < first) {
+        return false;
+    }
+
+    // the highest level where the range spans no more than 2 peaks
+    int level = 0;
+    while (level + 1 < (int) levels.size() && ((juce::int64) 2 << level) <= last - first + 1)
+    {
+        level++;
+    }
+    // peaks of the higher levels are only complete once all of the peaks below them are
+    while (level > 0 && (last >> level) >= getNumPeaksDone(level, done))
+    {
+        level--;
+    }
+
+    int lowest = 127;
+    int highest = -127;
+    for (juce::int64 i = first >> level; i <= last >> level; i++)
+    {
+        const Peak& peak = levels[(size_t) level][(size_t) i];
+        lowest = juce::jmin(lowest, (int) peak.min);
+        highest = juce::jmax(highest, (int) peak.max);
+    }
+
+    min = lowest / 127.0f;
+    max = highest / 127.0f;
+    return true;
+}
+
+juce::int64 WaveformPeaks::getLengthInSamples() const
+{
+    return length;
+}
+
+juce::int64 WaveformPeaks::getNumSamplesDone() const
+{
+    return numSamplesDone.load(std::memory_order_acquire);
+}
+
+bool WaveformPeaks::isComplete() const
+{
+    return getNumSamplesDone() >= length;
+}
+
+juce::int64 WaveformPeaks::getNumPeaksDone(int level, juce::int64 samplesDone) const
+{
+    if (samplesDone >= length) {
+        return (juce::int64) levels[(size_t) level].size();
+    }
+    return (samplesDone / samplesPerPeak) >> level;
+}
+
+//==============================================================================
+juce::File WaveformPeaks::getCacheFile(const juce::File& audioFile)
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(ProjectInfo::projectName)
+               .getChildFile("WaveformCache")
+               .getChildFile(juce::String::toHexString(audioFile.getFullPathName().hashCode64()) + ".peaks");
+}
+
+bool WaveformPeaks::saveToCache(const juce::File& cacheFile, const juce::File& audioFile) const
+{
+    if (!isComplete() || !cacheFile.getParentDirectory().createDirectory()) {
+        return false;
+    }
+
+    // written to a temporary file first, so a half-written cache file is never read
+    juce::TemporaryFile temp(cacheFile);
+    {
+        std::unique_ptr<juce::FileOutputStream> out(temp.getFile().createOutputStream());
+        if (out == nullptr) {
+            return false;
+        }
+
+        out->writeInt(cacheMagic);
+        out->writeInt(cacheVersion);
+        out->writeString(audioFile.getFullPathName());
+        out->writeInt64(audioFile.getSize());
+        out->writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+        out->writeInt64(length);
+        out->writeInt(samplesPerPeak);
+        out->write(levels[0].data(), levels[0].size() * sizeof(Peak));
+        out->flush();
+
+        if (out->getStatus().failed()) {
+            return false;
+        }
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+std::shared_ptr<WaveformPeaks> WaveformPeaks::loadFromCache(const juce::File& cacheFile, const juce::File& audioFile)
+{
+    juce::FileInputStream in(cacheFile);
+    if (!in.openedOk()) {
+        return nullptr;
+    }
+
+    // the path is checked as well as the size and modification time, in case two paths have the same hash
+    if (in.readInt() != cacheMagic || in.readInt() != cacheVersion
+        || in.readString() != audioFile.getFullPathName()
+        || in.readInt64() != audioFile.getSize()
+        || in.readInt64() != audioFile.getLastModificationTime().toMilliseconds()) {
+        return nullptr;
+    }
+
+    juce::int64 lengthInSamples = in.readInt64();
+    if (lengthInSamples < 0 || in.readInt() != samplesPerPeak) {
+        return nullptr;
+    }
+
+    auto peaks = std::make_shared<WaveformPeaks>(lengthInSamples);
+    std::vector<Peak>& firstLevel = peaks->levels[0];
+    size_t numBytes = firstLevel.size() * sizeof(Peak);
+    if ((size_t) in.read(firstLevel.data(), (int) numBytes) != numBytes) {
+        return nullptr;
+    }
+
+    peaks->addUpperLevels(0, lengthInSamples);
+    peaks->numSamplesDone.store(lengthInSamples, std::memory_order_release);
+    return peaks;
+}
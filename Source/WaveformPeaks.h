@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    WaveformPeaks.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "DecodedAudioCache.h"
+
+// This class holds a pyramid of the minimum and maximum sample values of a file, for drawing its
+// waveform at any zoom. Each peak of level 0 covers samplesPerPeak samples of every channel, and each
+// peak of the level above covers two peaks of the level below, up to a single peak for the whole file.
+// getRange() picks the level where a range spans at most a few peaks, so drawing a pixel costs the
+// same whether the file is a few seconds or a few hours long.
+// Peaks are added in order by a single thread while the file is read, and any thread can read the
+// peaks that are complete so far. Peaks are stored as 8-bit values (2 bytes each), so the pyramid
+// of a 2 hour file is about 5 MB, and only level 0 is saved to the cache file.
+
+class WaveformPeaks
+{
+public:
+    static constexpr int samplesPerPeak = 256;
+    static constexpr int chunkSamples = 65536; // samples read at a time by build(), a multiple of samplesPerPeak
+
+    struct Peak
+    {
+        juce::int8 min;
+        juce::int8 max;
+    };
+
+    /**
+     *@brief Allocates every level of the pyramid for a file of the given length. No peaks are complete yet.
+     */
+    WaveformPeaks(juce::int64 lengthInSamples);
+    ~WaveformPeaks();
+
+    /**
+     *@brief Reads a file's peaks from its cache file, or reads the file and builds them, saving them to the cache.
+     *Blocks until the peaks are complete, so it should be called on a background thread.
+     *@param file  the audio file
+     *@param formatManager  the format manager used to create the reader
+     *@param decodedCache  if not nullptr and the file's decoded audio is in it, the peaks are built from that instead of the file
+     *@param cancelled  checked between chunks; building stops early if it becomes true
+     *@param onCreated  called as soon as the peaks have been allocated, so they can be drawn while they're built
+     *@return  the peaks, or nullptr if the file couldn't be read or building was cancelled
+     */
+    static std::shared_ptr<WaveformPeaks> build(const juce::File& file, juce::AudioFormatManager& formatManager,
+                                                DecodedAudioCache* decodedCache, const std::atomic<bool>& cancelled,
+                                                const std::function<void(std::shared_ptr<WaveformPeaks>)>& onCreated);
+
+    /**
+     *@brief Adds the peaks of the next numSamples samples of the file. Only one thread may call this.
+     *@param source  the buffer holding the samples
+     *@param startSample  the index in source of the first sample
+     *@param numSamples  a multiple of samplesPerPeak, unless these are the last samples of the file
+     */
+    void addSamples(const juce::AudioBuffer<float>& source, int startSample, int numSamples);
+
+    /**
+     *@brief Finds the lowest and highest sample values in a range of the file, from the complete peaks.
+     *Looks at no more than a few peaks however long the range is, so the result can include up to one
+     *range's length of samples either side of it.
+     *@param startSample  the first sample of the range
+     *@param endSample  the sample after the last one in the range
+     *@param min  set to the lowest value, between -1 and 1
+     *@param max  set to the highest value, between -1 and 1
+     *@return  false if none of the range's peaks are complete yet
+     */
+    bool getRange(juce::int64 startSample, juce::int64 endSample, float& min, float& max) const;
+
+    juce::int64 getLengthInSamples() const;
+
+    /**
+     *@brief Returns the number of samples whose peaks are complete.
+     */
+    juce::int64 getNumSamplesDone() const;
+    bool isComplete() const;
+
+    /**
+     *@brief Returns the file a file's peaks are cached in: a file named after a hash of its path,
+     *in the WaveformCache folder of the user's application data folder.
+     */
+    static juce::File getCacheFile(const juce::File& audioFile);
+
+    /**
+     *@brief Saves level 0 to a cache file, along with the audio file's path, size and modification time.
+     *@return  true if the file was written
+     */
+    bool saveToCache(const juce::File& cacheFile, const juce::File& audioFile) const;
+
+    /**
+     *@brief Loads peaks saved by saveToCache() and rebuilds the levels above level 0.
+     *@return  the peaks, or nullptr if there's no cache file or the audio file has changed since it was saved
+     */
+    static std::shared_ptr<WaveformPeaks> loadFromCache(const juce::File& cacheFile, const juce::File& audioFile);
+
+private:
+    const juce::int64 length;
+    std::vector<std::vector<Peak>> levels; // level 0 first, sized up front so they never move
+    std::atomic<juce::int64> numSamplesDone; // released after the peaks it covers are written
+
+    /**
+     *@brief Returns the number of complete peaks in a level, given the number of samples done.
+     */
+    juce::int64 getNumPeaksDone(int level, juce::int64 samplesDone) const;
+
+    /**
+     *@brief Combines the peaks of the level below into every peak of each level above that the
+     *level 0 peaks from previousDone to done have completed.
+     */
+    void addUpperLevels(juce::int64 previousDone, juce::int64 done);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformPeaks)
+};